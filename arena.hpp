@@ -0,0 +1,70 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+/**
+ * Bump allocator: allocation is a pointer increment inside the current chunk,
+ * and memory is only given back to the system, in bulk, when the arena dies.
+ * Objects placed in an arena are not destroyed by it.
+ */
+class Arena {
+private:
+    struct Chunk {
+        char *begin, *cur, *end;
+    };
+
+    std::vector<Chunk> chunks;
+    size_t chunkSize;
+
+    void grow(size_t minSize) {
+        size_t size = minSize > chunkSize ? minSize : chunkSize;
+        auto begin = static_cast<char*>(std::malloc(size));
+        if (begin == nullptr) throw std::bad_alloc();
+        chunks.push_back(Chunk { begin, begin, begin + size });
+    }
+
+public:
+    explicit Arena(size_t chunkSize = 64 * 1024): chunkSize(chunkSize) {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+        for (auto& chunk: chunks) std::free(chunk.begin);
+    }
+
+    void * allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        if (!chunks.empty()) {
+            Chunk& chunk = chunks.back();
+            auto addr = reinterpret_cast<std::uintptr_t>(chunk.cur);
+            char *ptr = chunk.cur + ((align - addr % align) % align);
+            if (ptr + size <= chunk.end) {
+                chunk.cur = ptr + size;
+                return ptr;
+            }
+        }
+        grow(size + align);
+        return allocate(size, align);
+    }
+
+    // recent chunks are searched first, since that's where new objects live
+    bool owns(const void *ptr) const {
+        auto p = static_cast<const char*>(ptr);
+        for (auto chunk = chunks.rbegin(); chunk != chunks.rend(); ++chunk) {
+            if (chunk->begin <= p && p < chunk->end) return true;
+        }
+        return false;
+    }
+
+    size_t bytesUsed() const {
+        size_t used = 0;
+        for (auto& chunk: chunks) used += chunk.cur - chunk.begin;
+        return used;
+    }
+};
+
+#endif // ARENA_HPP
@@ -1,3 +1,4 @@
+#include <atomic>
 #include <cctype>
 #include <exception>
 #include <typeinfo>
@@ -26,9 +27,47 @@ inline static void execLeave(initializer_list<Visitor*> visitors, T *self, Node
 }
 
 
+NodeArena::~NodeArena() {
+    // children are never deleted by their parents inside an arena (see Node::arena)
+    for (auto node = nodes.rbegin(); node != nodes.rend(); ++node) {
+        if (*node != nullptr) (*node)->~Node();
+    }
+}
+
+// only reached when a node is deleted early, e.g. during error recovery of the parser
+void NodeArena::release(const void *ptr) {
+    for (auto node = nodes.rbegin(); node != nodes.rend(); ++node) {
+        if (*node == ptr) {
+            *node = nullptr;
+            return;
+        }
+    }
+}
+
+
 Node::Node() {
-    static int gid = 0;
+    static std::atomic<unsigned> gid { 0 };   // nodes may be created by concurrent parses
     nodeId = gid++;
+    arena = NodeArena::active();
+    if (arena != nullptr && arena->owns(this)) {
+        arena->adopt(this);
+    } else {
+        arena = nullptr;
+    }
+}
+
+void * Node::operator new(size_t size) {
+    NodeArena *arena = NodeArena::active();
+    return arena != nullptr ? arena->allocate(size) : ::operator new(size);
+}
+
+void Node::operator delete(void *ptr, size_t size) {
+    NodeArena *arena = NodeArena::active();
+    if (arena != nullptr && arena->owns(ptr)) {
+        arena->release(ptr);
+    } else {
+        ::operator delete(ptr);
+    }
 }
 
 void Node::setLocation(const YYLTYPE * location) {
@@ -58,7 +97,7 @@ Program::Program(const list<ExtDef*>& extDefList):
 }
 
 Program::~Program() {
-    deleteAll(extDefs);
+    if (storage == nullptr) deleteAll(extDefs);
 }
 
 void Program::visit(Visitor *visitor) {
@@ -110,7 +149,7 @@ Dec::Dec(VarDec * declarator, Exp * init): declarator(declarator), init(init) {
 }
 
 Dec::~Dec() {
-    deleteAll(declarator, init);
+    if (arena == nullptr) deleteAll(declarator, init);
 }
 
 void Dec::visit(Visitor *visitor) {
@@ -135,7 +174,7 @@ Def::Def(Specifier * specifier, const list<Dec*>& decList):
 }
 
 Def::~Def() {
-    deleteAll(specifier, declarations);
+    if (arena == nullptr) deleteAll(specifier, declarations);
 }
 
 void Def::visit(Visitor *visitor) {
@@ -160,7 +199,7 @@ ParamDec::ParamDec(Specifier * specifier, VarDec * declarator):
 }
 
 ParamDec::~ParamDec() {
-    deleteAll(specifier, declarator);
+    if (arena == nullptr) deleteAll(specifier, declarator);
 }
 
 void ParamDec::visit(Visitor *visitor) {
@@ -175,8 +214,8 @@ void ParamDec::traverse(initializer_list<Visitor*> visitors, Node *parent) {
 }
 
 
-FunDec::FunDec(string identifier, const list<ParamDec*>& varList):
-    identifier(std::move(identifier)), parameters(varList.begin(), varList.end())
+FunDec::FunDec(Ident identifier, const list<ParamDec*>& varList):
+    identifier(identifier), parameters(varList.begin(), varList.end())
 {
     if (hasNull(this->parameters)) {
         deleteAll(this->parameters);
@@ -185,7 +224,7 @@ FunDec::FunDec(string identifier, const list<ParamDec*>& varList):
 }
 
 FunDec::~FunDec() {
-    deleteAll(parameters);
+    if (arena == nullptr) deleteAll(parameters);
 }
 
 void FunDec::visit(Visitor *visitor) {
@@ -209,19 +248,23 @@ void Specifier::traverse(initializer_list<Visitor*> visitors, Node *parent) {
 }
 
 
+PrimitiveSpecifier::PrimitiveSpecifier(smt::Primitive primitive):
+    primitive(primitive)
+{
+    type = smt::TypeContext::primitive(primitive);
+}
+
 PrimitiveSpecifier::PrimitiveSpecifier(const string& typeName) {
     if (typeName == "char") {
         primitive = smt::Primitive::CHAR;
-        type.set(new smt::PrimitiveType(smt::Primitive::CHAR));
     } else if (typeName == "int") {
         primitive = smt::Primitive::INT;
-        type.set(new smt::PrimitiveType(smt::Primitive::INT));
     } else if (typeName == "float") {
         primitive = smt::Primitive::FLOAT;
-        type.set(new smt::PrimitiveType(smt::Primitive::FLOAT));
     } else {
         throw invalid_argument("illegal primitive type");
     }
+    type = smt::TypeContext::primitive(primitive);
 }
 
 void PrimitiveSpecifier::visit(Visitor *visitor) {
@@ -234,18 +277,17 @@ void PrimitiveSpecifier::traverse(initializer_list<Visitor*> visitors, Node *par
 }
 
 
-StructSpecifier::StructSpecifier(string identifier, const list<Def*>& defList):
-    identifier(std::move(identifier)), definitions(defList.begin(), defList.end())
+StructSpecifier::StructSpecifier(Ident identifier, const list<Def*>& defList):
+    identifier(identifier), definitions(defList.begin(), defList.end())
 {
     if (hasNull(this->definitions)) {
         deleteAll(this->definitions);
         throw invalid_argument("definitions cannot be null");
     }
-    type.set(new smt::StructType);
 }
 
 StructSpecifier::~StructSpecifier() {
-    deleteAll(definitions);
+    if (arena == nullptr) deleteAll(definitions);
 }
 
 void StructSpecifier::visit(Visitor *visitor) {
@@ -279,7 +321,7 @@ ExtVarDef::ExtVarDef(Specifier * specifier, const list<VarDec*>& extDecList):
 }
 
 ExtVarDef::~ExtVarDef() {
-    deleteAll(specifier, varDecs);
+    if (arena == nullptr) deleteAll(specifier, varDecs);
 }
 
 void ExtVarDef::visit(Visitor *visitor) {
@@ -301,7 +343,7 @@ StructDef::StructDef(Specifier * specifier):
 }
 
 StructDef::~StructDef() {
-    delete specifier;
+    if (arena == nullptr) delete specifier;
 }
 
 void StructDef::visit(Visitor *visitor) {
@@ -325,7 +367,7 @@ FunDef::FunDef(Specifier * specifier, FunDec * declarator, CompoundStmt * body):
 }
 
 FunDef::~FunDef() {
-    deleteAll(specifier, declarator, body);
+    if (arena == nullptr) deleteAll(specifier, declarator, body);
 }
 
 void FunDef::visit(Visitor *visitor) {
@@ -354,15 +396,15 @@ void Exp::traverse(initializer_list<Visitor*> visitors, Node *parent) {
 
 
 LiteralExp::LiteralExp(char val):
-    Exp(Shared<smt::Type>(new smt::PrimitiveType(smt::Primitive::CHAR))),
+    Exp(smt::TypeContext::primitive(smt::Primitive::CHAR)),
     charVal(val) {}
 
 LiteralExp::LiteralExp(int val):
-    Exp(Shared<smt::Type>(new smt::PrimitiveType(smt::Primitive::INT))),
+    Exp(smt::TypeContext::primitive(smt::Primitive::INT)),
     intVal(val) {}
 
 LiteralExp::LiteralExp(double val):
-    Exp(Shared<smt::Type>(new smt::PrimitiveType(smt::Primitive::FLOAT))),
+    Exp(smt::TypeContext::primitive(smt::Primitive::FLOAT)),
     floatVal(val) {}
 
 void LiteralExp::visit(Visitor *visitor) {
@@ -375,13 +417,14 @@ void LiteralExp::traverse(initializer_list<Visitor*> visitors, Node *parent) {
 }
 
 
-IdExp::IdExp(const string& identifier): identifier(identifier) {
-    auto itr = identifier.begin();
-    if (itr == identifier.end()) throw invalid_argument("identifier cannot be empty");
+IdExp::IdExp(const char *identifier) {
+    const char *itr = identifier;
+    if (*itr == '\0') throw invalid_argument("identifier cannot be empty");
     if (!isalpha(*itr) && *itr != '_') throw invalid_argument("illegal identifier");
-    for (++itr; itr != identifier.end(); ++itr) {
+    for (++itr; *itr != '\0'; ++itr) {
         if (!isalnum(*itr) && *itr != '_') throw invalid_argument("illegal identifier");
     }
+    this->identifier = Ident(identifier);
 }
 
 void IdExp::visit(Visitor *visitor) {
@@ -402,7 +445,7 @@ ArrayExp::ArrayExp(Exp * subject, Exp * index): subject(subject), index(index) {
 }
 
 ArrayExp::~ArrayExp() {
-    deleteAll(subject, index);
+    if (arena == nullptr) deleteAll(subject, index);
 }
 
 void ArrayExp::visit(Visitor *visitor) {
@@ -417,14 +460,14 @@ void ArrayExp::traverse(initializer_list<Visitor*> visitors, Node *parent) {
 }
 
 
-MemberExp::MemberExp(Exp *subject, string member):
-    subject(subject), member(std::move(member))
+MemberExp::MemberExp(Exp *subject, Ident member):
+    subject(subject), member(member)
 {
     if (subject == nullptr) throw invalid_argument("subject cannot be null");
 }
 
 MemberExp::~MemberExp() {
-    delete subject;
+    if (arena == nullptr) delete subject;
 }
 
 void MemberExp::visit(Visitor *visitor) {
@@ -448,7 +491,7 @@ UnaryExp::UnaryExp(Operator opt, Exp * argument):
 }
 
 UnaryExp::~UnaryExp() {
-    delete argument;
+    if (arena == nullptr) delete argument;
 }
 
 void UnaryExp::visit(Visitor *visitor) {
@@ -472,7 +515,7 @@ BinaryExp::BinaryExp(Exp * left, Operator opt, Exp * right):
 }
 
 BinaryExp::~BinaryExp() {
-    deleteAll(left, right);
+    if (arena == nullptr) deleteAll(left, right);
 }
 
 void BinaryExp::visit(Visitor *visitor) {
@@ -495,7 +538,7 @@ AssignExp::AssignExp(Exp * left, Exp * right): left(left), right(right) {
 }
 
 AssignExp::~AssignExp() {
-    deleteAll(left, right);
+    if (arena == nullptr) deleteAll(left, right);
 }
 
 void AssignExp::visit(Visitor *visitor) {
@@ -510,8 +553,8 @@ void AssignExp::traverse(initializer_list<Visitor*> visitors, Node *parent) {
 }
 
 
-CallExp::CallExp(string identifier, const list<Exp*>& arguments):
-    identifier(std::move(identifier)), arguments(arguments.begin(), arguments.end())
+CallExp::CallExp(Ident identifier, const list<Exp*>& arguments):
+    identifier(identifier), arguments(arguments.begin(), arguments.end())
 {
     if (hasNull(this->arguments)) {
         deleteAll(this->arguments);
@@ -520,7 +563,7 @@ CallExp::CallExp(string identifier, const list<Exp*>& arguments):
 }
 
 CallExp::~CallExp() {
-    deleteAll(arguments);
+    if (arena == nullptr) deleteAll(arguments);
 }
 
 void CallExp::visit(Visitor *visitor) {
@@ -581,6 +624,10 @@ IfStmt::IfStmt(Exp * test, Stmt * consequent, Stmt * alternate):
     }
 }
 
+IfStmt::~IfStmt() {
+    if (arena == nullptr) deleteAll(test, consequent, alternate);
+}
+
 void IfStmt::visit(Visitor *visitor) {
     visitor->visit(this);
 }
@@ -601,6 +648,10 @@ WhileStmt::WhileStmt(Exp * test, Stmt * body): test(test), body(body) {
     }
 }
 
+WhileStmt::~WhileStmt() {
+    if (arena == nullptr) deleteAll(test, body);
+}
+
 void WhileStmt::visit(Visitor *visitor) {
     visitor->visit(this);
 }
@@ -622,6 +673,10 @@ ForStmt::ForStmt(Exp * init, Exp * test, Exp * update, Stmt * body):
     }
 }
 
+ForStmt::~ForStmt() {
+    if (arena == nullptr) deleteAll(init, test, update, body);
+}
+
 void ForStmt::visit(Visitor *visitor) {
     visitor->visit(this);
 }
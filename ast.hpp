@@ -7,6 +7,8 @@
 #include <string>
 #include <utility>
 #include <vector>
+#include "arena.hpp"
+#include "ident.hpp"
 #include "symbol_table.hpp"
 #include "tac.hpp"
 #include "type.hpp"
@@ -64,12 +66,62 @@ struct Location {
     Location(): start { .line = 0, .column = 0 }, end {.line = 0, .column = 0} {}
 };
 
+/**
+ * Owns every node created on its thread while it is active: nodes are bump-allocated
+ * and destroyed together with the arena in a single flat pass instead of a tree walk.
+ */
+class NodeArena {
+private:
+    Arena memory;
+    std::vector<Node*> nodes;
+    inline static thread_local NodeArena * current = nullptr;
+
+public:
+    // makes an arena active on the current thread during its lifetime
+    class Guard {
+    private:
+        NodeArena *prev;
+    public:
+        explicit Guard(NodeArena *arena): prev(current) { current = arena; }
+        Guard(const Guard&) = delete;
+        ~Guard() { current = prev; }
+    };
+
+    NodeArena() = default;
+    NodeArena(const NodeArena&) = delete;
+    ~NodeArena();
+
+    static NodeArena * active() {
+        return current;
+    }
+
+    void * allocate(size_t size) {
+        return memory.allocate(size);
+    }
+
+    bool owns(const void *ptr) const {
+        return memory.owns(ptr);
+    }
+
+    void adopt(Node *node) {
+        nodes.push_back(node);
+    }
+
+    void release(const void *ptr);
+
+    size_t size() const {
+        return nodes.size();
+    }
+};
+
 struct Node {
     unsigned nodeId;
     Location loc;
-    std::shared_ptr<smt::SymbolTable> scope;
+    NodeArena *arena;   // owner of this node, or nullptr if it lives on the heap/stack
     Node();
     virtual ~Node() = default;
+    static void * operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
     void setLocation(const YYLTYPE * loc);
     virtual void visit(Visitor *visitor);
     virtual void traverse(std::initializer_list<Visitor*> visitors, Node *parent);
@@ -81,11 +133,23 @@ struct Node {
 
 struct Program final: public Node {
     std::vector<ExtDef*> extDefs;
+    smt::TypeContext types;
+    smt::SymbolTable symbols;
+    std::unique_ptr<NodeArena> storage;     // owns the tree when it was built in an arena
 
     explicit Program(const std::list<ExtDef*>& extDefList);
     ~Program() override;
     void traverse(std::initializer_list<Visitor*> visitors);
 
+    // the root always lives on the heap, since it outlives (and owns) the arena
+    static void * operator new(size_t size) {
+        return ::operator new(size);
+    }
+
+    static void operator delete(void *ptr, size_t size) {
+        ::operator delete(ptr);
+    }
+
     OVERRIDE_VISITOR_HOOKS
 };
 
@@ -93,9 +157,10 @@ struct Program final: public Node {
 // declaration/definition
 
 struct VarDec: public Node {
-    std::string identifier;
+    Ident identifier;
+    smt::Symbol *symbol = nullptr;  // bound during semantic analysis
 
-    explicit VarDec(std::string identifier): identifier(std::move(identifier)) {}
+    explicit VarDec(Ident identifier): identifier(identifier) {}
     ~VarDec() override = default;
 
     OVERRIDE_VISITOR_HOOKS
@@ -140,17 +205,17 @@ struct ParamDec: public Node {
 };
 
 struct FunDec: public Node {
-    std::string identifier;
+    Ident identifier;
     std::vector<ParamDec*> parameters;
 
-    explicit FunDec(std::string identifier, const std::list<ParamDec*>& varList = {});
+    explicit FunDec(Ident identifier, const std::list<ParamDec*>& varList = {});
     ~FunDec() override;
 
     OVERRIDE_VISITOR_HOOKS
 };
 
 struct Specifier: public Node {
-    Shared<smt::Type> type;
+    const smt::Type * type = nullptr;
 
     OVERRIDE_VISITOR_HOOKS
 };
@@ -158,16 +223,17 @@ struct Specifier: public Node {
 struct PrimitiveSpecifier final: public Specifier {
     smt::Primitive primitive;
 
+    explicit PrimitiveSpecifier(smt::Primitive primitive);
     explicit PrimitiveSpecifier(const std::string& typeName);
 
     OVERRIDE_VISITOR_HOOKS
 };
 
 struct StructSpecifier final: public Specifier {
-    std::string identifier;
+    Ident identifier;
     std::vector<Def*> definitions;
 
-    explicit StructSpecifier(std::string identifier, const std::list<Def*>& defList = {});
+    explicit StructSpecifier(Ident identifier, const std::list<Def*>& defList = {});
     ~StructSpecifier() override;
 
     OVERRIDE_VISITOR_HOOKS
@@ -210,10 +276,10 @@ struct FunDef final: public ExtDef {
 // ------------------------ expressions ------------------------------
 
 struct Exp: public Node {
-    Shared<smt::Type> type;
+    const smt::Type * type = nullptr;
 
     Exp() = default;
-    explicit Exp(Shared<smt::Type> type): type(std::move(type)) {}
+    explicit Exp(const smt::Type * type): type(type) {}
     ~Exp() override = default;
 
     OVERRIDE_VISITOR_HOOKS
@@ -236,9 +302,11 @@ struct LiteralExp final: public Exp {
 
 
 struct IdExp final: public Exp {
-    std::string identifier;
+    Ident identifier;
+    smt::Symbol *symbol = nullptr;  // bound during semantic analysis
 
-    explicit IdExp(const std::string&);
+    explicit IdExp(Ident identifier): identifier(identifier) {}
+    explicit IdExp(const char *identifier);     // validates the name
 
     OVERRIDE_VISITOR_HOOKS
 };
@@ -254,9 +322,9 @@ struct ArrayExp: public Exp {
 
 struct MemberExp: public Exp {
     Exp * subject;
-    std::string member;
+    Ident member;
 
-    MemberExp(Exp *subject, std::string member);
+    MemberExp(Exp *subject, Ident member);
     ~MemberExp() override;
 
     OVERRIDE_VISITOR_HOOKS
@@ -308,10 +376,10 @@ struct AssignExp: public Exp {
 };
 
 struct CallExp: public Exp {
-    std::string identifier;
+    Ident identifier;
     std::vector<Exp*> arguments;
 
-    explicit CallExp(std::string identifier, const std::list<Exp*>& arguments = {});
+    explicit CallExp(Ident identifier, const std::list<Exp*>& arguments = {});
     ~CallExp() override;
 
     OVERRIDE_VISITOR_HOOKS
@@ -329,7 +397,7 @@ struct ExpStmt final: public Stmt {
 
     explicit ExpStmt(Exp *expression);
     ~ExpStmt() override {
-        delete expression;
+        if (arena == nullptr) delete expression;
     }
 
     OVERRIDE_VISITOR_HOOKS
@@ -340,7 +408,7 @@ struct ReturnStmt final: public Stmt {
 
     explicit ReturnStmt(Exp *argument = nullptr): argument(argument) {}
     ~ReturnStmt() override {
-        delete argument;
+        if (arena == nullptr) delete argument;
     }
 
     OVERRIDE_VISITOR_HOOKS
@@ -351,6 +419,7 @@ struct IfStmt final: public Stmt {
     Stmt *consequent, *alternate;
 
     IfStmt(Exp *test, Stmt *consequent, Stmt *alternate = nullptr);
+    ~IfStmt() override;
 
     OVERRIDE_VISITOR_HOOKS
 };
@@ -360,6 +429,7 @@ struct WhileStmt final: public Stmt {
     Stmt *body;
 
     WhileStmt(Exp *test, Stmt *body);
+    ~WhileStmt() override;
 
     OVERRIDE_VISITOR_HOOKS
 };
@@ -369,6 +439,7 @@ struct ForStmt final: public Stmt {
     Stmt *body;
 
     ForStmt(Exp *init, Exp *test, Exp *update, Stmt *body);
+    ~ForStmt() override;
 
     OVERRIDE_VISITOR_HOOKS
 };
@@ -381,6 +452,7 @@ struct CompoundStmt final: public Stmt {
         definitions(defList.begin(), defList.end()),
         body(stmtList.begin(), stmtList.end()) {}
     ~CompoundStmt() override {
+        if (arena != nullptr) return;
         for (auto def: definitions) delete def;
         for (auto stmt: body) delete stmt;
     }
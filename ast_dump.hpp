@@ -1,6 +1,7 @@
 #ifndef AST_DUMP_HPP
 #define AST_DUMP_HPP
 
+#include <map>
 #include <ostream>
 #include <string>
 #include <unordered_map>
@@ -10,7 +11,7 @@
 
 namespace ast {
 
-std::ostream& operator<<(std::ostream& out, const Location& loc) {
+inline std::ostream& operator<<(std::ostream& out, const Location& loc) {
     return out << "@[" << loc.start.line << '.' << loc.start.column
         << '~' << loc.end.line << '.' << loc.end.column << ']';
 }
@@ -125,6 +126,21 @@ public:
     }
 };
 
+
+// counts nodes of each kind
+class Counter: public Visitor {
+public:
+    std::map<std::string, size_t> counts;
+
+    #define DEFINE_COUNTER_ENTER(T)                 \
+    void enter(T *self, Node *parent) override {    \
+        ++counts[#T];                               \
+    }
+
+    FOR_ALL_AST_NODES(DEFINE_COUNTER_ENTER)
+    #undef DEFINE_COUNTER_ENTER
+};
+
 }
 
 #endif // AST_DUMP_HPP
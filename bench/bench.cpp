@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include "ast_dump.hpp"
+#include "gen_tac.hpp"
+#include "ir_writer.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+#include "semantic.hpp"
+#include "workload.hpp"
+
+using namespace std;
+
+
+// best wall time (in seconds) of a phase over all repetitions
+struct PhaseTime {
+    const char *name;
+    double best = 1e100;
+
+    template <typename Phase>
+    void measure(Phase&& phase) {
+        auto start = chrono::steady_clock::now();
+        phase();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count());
+    }
+};
+
+static void usage(const char *program) {
+    cerr << "Usage:\n\t" << program << " [--functions N] [--statements N] [--depth N] [--nesting N]\n"
+         << "\t\t[--structs P] [--arrays P] [--seed N] [--repeat N] [--opt LEVEL] [--dump]\n"
+         << "\tP is the chance in [0, 1] that a statement or an operand accesses a structure or an array" << endl;
+    exit(1);
+}
+
+static void report(const PhaseTime& phase, size_t nodes, size_t bytes) {
+    printf("%-10s %10.3f ms %12.3f Mnodes/s", phase.name, phase.best * 1e3, nodes / phase.best / 1e6);
+    if (bytes > 0) printf(" %10.3f MB/s", bytes / phase.best / 1e6);
+    printf("\n");
+}
+
+
+int main(int argc, const char **argv) {
+    WorkloadShape shape;
+    int repeat = 5;
+    int optLevel = 1;
+    bool dump = false;
+    for (int i = 1; i < argc; ++i) {
+        auto arg = [&]() { return i + 1 < argc ? argv[++i] : (usage(argv[0]), ""); };
+        if (strcmp(argv[i], "--functions") == 0) shape.functions = atoi(arg());
+        else if (strcmp(argv[i], "--statements") == 0) shape.statements = atoi(arg());
+        else if (strcmp(argv[i], "--depth") == 0) shape.exprDepth = atoi(arg());
+        else if (strcmp(argv[i], "--nesting") == 0) shape.nesting = atoi(arg());
+        else if (strcmp(argv[i], "--structs") == 0) shape.structDensity = atof(arg());
+        else if (strcmp(argv[i], "--arrays") == 0) shape.arrayDensity = atof(arg());
+        else if (strcmp(argv[i], "--seed") == 0) shape.seed = atoi(arg());
+        else if (strcmp(argv[i], "--repeat") == 0) repeat = max(1, atoi(arg()));
+        else if (strcmp(argv[i], "--opt") == 0) optLevel = atoi(arg());
+        else if (strcmp(argv[i], "--dump") == 0) dump = true;
+        else usage(argv[0]);
+    }
+
+    string src = generateWorkload(shape);
+    if (dump) {
+        cout << src;
+        return 0;
+    }
+
+    PhaseTime parsing { "parse" }, analysis { "semantic" }, generation { "gen_tac" }, optimization { "optimize" },
+        printing { "print" };
+    size_t nodes = 0, tacs = 0, optimizedTacs = 0, irBytes = 0;
+    bool tacSupported = true;
+
+    for (int round = 0; round < repeat; ++round) {
+        unique_ptr<ast::Program> program;
+        parsing.measure([&]() { program.reset(parseStr(src.c_str())); });
+        if (program == nullptr) {
+            cerr << "the generated program cannot be parsed" << endl;
+            return 1;
+        }
+        if (round == 0) {
+            auto counter = make_unique<ast::Counter>();
+            program->traverse({ counter.get() });
+            for (auto& count: counter->counts) nodes += count.second;
+        }
+
+        size_t errNum = 0;
+        analysis.measure([&]() { errNum = smt::analyzeSemantic(program.get()).size(); });
+        if (errNum > 0) {
+            cerr << "the generated program has " << errNum << " semantic errors" << endl;
+            return 1;
+        }
+
+        unique_ptr<ir::TacGenerator> generator;
+        try {
+            generation.measure([&]() { generator = make_unique<ir::TacGenerator>(program.get()); });
+        } catch (const exception& e) {
+            tacSupported = false;   // e.g. structures and arrays
+            cerr << "TAC generation skipped: " << e.what() << endl;
+            continue;
+        }
+        tacs = generator->getTac().size();
+
+        // the printer still takes the code as generated
+        if (optLevel > 0) {
+            ir::Code code = generator->getTac();
+            optimization.measure([&]() { ir::optimize(code, optLevel); });
+            optimizedTacs = code.size();
+        }
+
+        ostringstream ir;
+        printing.measure([&]() { ir::IrWriter(ir) << generator->getTac(); });
+        irBytes = ir.str().size();
+    }
+
+    printf("source: %zu bytes, %zu AST nodes", src.size(), nodes);
+    if (tacSupported) printf(", %zu TAC instructions, %zu IR bytes", tacs, irBytes);
+    if (tacSupported && optLevel > 0) printf(", %zu TAC instructions at -O%d", optimizedTacs, optLevel);
+    printf("; best of %d runs\n", repeat);
+    report(parsing, nodes, src.size());
+    report(analysis, nodes, 0);
+    if (tacSupported) {
+        report(generation, nodes, 0);
+        if (optLevel > 0) report(optimization, nodes, 0);
+        report(printing, nodes, irBytes);
+    }
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "workload.hpp"
+
+using namespace std;
+
+
+namespace {
+
+class WorkloadGenerator {
+private:
+    const WorkloadShape& shape;
+    mt19937 random;
+    string out;
+    int funcNo = 0;
+    int localSeq = 0;
+    vector<string> vars;    // visible integer variables
+
+    bool chance(double probability) {
+        return uniform_real_distribution<double>(0, 1)(random) < probability;
+    }
+
+    int pick(int bound) {
+        return uniform_int_distribution<int>(0, bound - 1)(random);
+    }
+
+    void indent(int level) {
+        out.append(4 * level, ' ');
+    }
+
+    void genOperand() {
+        if (chance(shape.structDensity)) {
+            out += pick(2) ? "s.x" : "s.y";
+        } else if (chance(shape.arrayDensity)) {
+            out += "a[" + to_string(pick(8)) + "]";
+        } else if (chance(0.3)) {
+            out += to_string(pick(100));
+        } else {
+            out += vars[pick(vars.size())];
+        }
+    }
+
+    void genExp(int depth) {
+        if (depth <= 0) {
+            genOperand();
+            return;
+        }
+        int kind = pick(20);
+        if (kind == 0 && funcNo > 0) {
+            out += "f" + to_string(pick(funcNo)) + "(";
+            genExp(depth - 1);
+            out += ", ";
+            genExp(depth - 1);
+            out += ")";
+        } else if (kind == 1) {
+            out += "-(";
+            genExp(depth - 1);
+            out += ")";
+        } else {
+            static const char *opts[] = { " + ", " - ", " * ", " / " };
+            out += "(";
+            genExp(depth - 1);
+            out += opts[pick(4)];
+            genExp(depth - 1);
+            out += ")";
+        }
+    }
+
+    void genCond(int depth) {
+        static const char *relops[] = { " < ", " <= ", " > ", " >= ", " == ", " != " };
+        genExp(depth);
+        out += relops[pick(6)];
+        genExp(depth);
+        if (chance(0.3)) {
+            out += pick(2) ? " && " : " || ";
+            genExp(depth);
+            out += relops[pick(6)];
+            genExp(depth);
+        }
+    }
+
+    void genBlock(int level, int stmtNum) {
+        out += "{\n";
+        size_t visible = vars.size();
+        int defNum = 1 + pick(2);
+        for (int i = 0; i < defNum; ++i) {
+            string name = "w" + to_string(localSeq++);
+            indent(level + 1);
+            out += "int " + name + " = ";
+            genExp(shape.exprDepth);
+            out += ";\n";
+            vars.push_back(name);
+        }
+        for (int i = 0; i < stmtNum; ++i) genStmt(level + 1);
+        vars.resize(visible);
+        indent(level);
+        out += "}";
+    }
+
+    void genStmt(int level) {
+        int nestedNum = max(1, shape.statements / 4);
+        indent(level);
+        if (level <= shape.nesting && chance(0.15)) {
+            out += "if (";
+            genCond(shape.exprDepth - 1);
+            out += ") ";
+            genBlock(level, nestedNum);
+            if (chance(0.5)) {
+                out += " else ";
+                genBlock(level, nestedNum);
+            }
+            out += "\n";
+        } else if (level <= shape.nesting && chance(0.1)) {
+            out += "while (";
+            genCond(shape.exprDepth - 1);
+            out += ") ";
+            genBlock(level, nestedNum);
+            out += "\n";
+        } else if (chance(0.05)) {
+            out += "write(";
+            genExp(shape.exprDepth);
+            out += ");\n";
+        } else {
+            if (chance(shape.structDensity)) {
+                out += pick(2) ? "s.x" : "s.y";
+            } else if (chance(shape.arrayDensity)) {
+                out += "a[" + to_string(pick(8)) + "]";
+            } else {
+                out += vars[pick(vars.size())];
+            }
+            out += " = ";
+            genExp(shape.exprDepth);
+            out += ";\n";
+        }
+    }
+
+    void genFunction() {
+        localSeq = 0;
+        vars = { "p0", "p1", "v0", "v1" };
+        out += "int f" + to_string(funcNo) + "(int p0, int p1)\n{\n";
+        out += "    int v0 = p0, v1 = p1;\n";
+        if (shape.structDensity > 0) out += "    struct Point s;\n";
+        if (shape.arrayDensity > 0) out += "    int a[8];\n";
+        for (int i = 0; i < shape.statements; ++i) genStmt(1);
+        out += "    return ";
+        genExp(shape.exprDepth);
+        out += ";\n}\n\n";
+    }
+
+public:
+    explicit WorkloadGenerator(const WorkloadShape& shape): shape(shape), random(shape.seed) {}
+
+    string generate() {
+        if (shape.structDensity > 0) {
+            out += "struct Point {\n    int x;\n    int y;\n};\n\n";
+        }
+        for (funcNo = 0; funcNo < shape.functions; ++funcNo) {
+            genFunction();
+        }
+        return move(out);
+    }
+};
+
+} // namespace
+
+
+string generateWorkload(const WorkloadShape& shape) {
+    return WorkloadGenerator(shape).generate();
+}
@@ -0,0 +1,20 @@
+#ifndef WORKLOAD_HPP
+#define WORKLOAD_HPP
+
+#include <string>
+
+// shape of a synthetic SPL program
+struct WorkloadShape {
+    int functions = 100;
+    int statements = 20;        // per function body, and a quarter of it per nested block
+    int exprDepth = 3;          // of the operator tree of an expression
+    int nesting = 2;            // of if/while blocks
+    double structDensity = 0;   // chance that a statement or an operand touches a structure member
+    double arrayDensity = 0;    // chance that a statement or an operand touches an array element
+    unsigned seed = 1;
+};
+
+// generates a program that passes semantic analysis; equal shapes give equal programs
+std::string generateWorkload(const WorkloadShape& shape);
+
+#endif // WORKLOAD_HPP
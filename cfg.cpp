@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "cfg.hpp"
+#include "optimizer.hpp"
+
+using namespace ir;
+using namespace std;
+
+
+Cfg::Cfg(const Code& code, size_t first, size_t last): code(code) {
+    if (first >= last || code.tacs[first].op != Opcode::FUNCTION) {
+        throw invalid_argument("a control-flow graph begins with FUNCTION");
+    }
+    split(first, last);
+    link();
+    computeDominators();
+    findLoops();
+}
+
+vector<Cfg> Cfg::ofFunctions(const Code& code) {
+    vector<Cfg> graphs;
+    for (auto& range: functionRanges(code)) graphs.emplace_back(code, range.first, range.second);
+    return graphs;
+}
+
+void Cfg::split(size_t first, size_t last) {
+    size_t begin = first;
+    for (size_t i = first; i < last; ++i) {
+        auto op = code.tacs[i].op;
+        // a label begins a block, and a jump or RETURN ends one
+        if (op == Opcode::LABEL && i > begin) {
+            blockList.push_back({ begin, i, {}, {}, NO_BLOCK });
+            begin = i;
+        }
+        if (isJump(op) || op == Opcode::RETURN) {
+            blockList.push_back({ begin, i + 1, {}, {}, NO_BLOCK });
+            begin = i + 1;
+        }
+    }
+    if (begin < last) blockList.push_back({ begin, last, {}, {}, NO_BLOCK });
+}
+
+void Cfg::link() {
+    vector<uint32_t> labelBlocks;   // by label number
+    for (uint32_t b = 0; b < blockList.size(); ++b) {
+        auto& tac = code.tacs[blockList[b].first];
+        if (tac.op != Opcode::LABEL) continue;
+        uint32_t label = tac.result.value();
+        if (label >= labelBlocks.size()) labelBlocks.resize(label + 1, NO_BLOCK);
+        labelBlocks[label] = b;
+    }
+
+    auto addEdge = [&](uint32_t from, uint32_t to) {
+        auto& succs = blockList[from].succs;
+        if (find(succs.begin(), succs.end(), to) != succs.end()) return;
+        succs.push_back(to);
+        blockList[to].preds.push_back(from);
+    };
+    for (uint32_t b = 0; b < blockList.size(); ++b) {
+        auto& tac = code.tacs[blockList[b].last - 1];
+        if (isJump(tac.op)) {
+            uint32_t label = tac.result.value();
+            if (label >= labelBlocks.size() || labelBlocks[label] == NO_BLOCK) {
+                throw runtime_error("jump to undefined label" + to_string(label) + " in function " + functionName());
+            }
+            addEdge(b, labelBlocks[label]);
+        }
+        // control falls through to the next block, unless it leaves unconditionally
+        if (tac.op != Opcode::GOTO && tac.op != Opcode::RETURN && b + 1 < blockList.size()) addEdge(b, b + 1);
+    }
+}
+
+// as by Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm"
+void Cfg::computeDominators() {
+    // reverse postorder of a depth-first search from the entry
+    vector<bool> visited(blockList.size());
+    vector<pair<uint32_t, size_t>> stack { { 0, 0 } };  // blocks, with their next successor
+    visited[0] = true;
+    while (!stack.empty()) {
+        auto& top = stack.back();
+        auto& succs = blockList[top.first].succs;
+        if (top.second < succs.size()) {
+            uint32_t next = succs[top.second++];
+            if (!visited[next]) {
+                visited[next] = true;
+                stack.emplace_back(next, 0);
+            }
+        } else {
+            order.push_back(top.first);
+            stack.pop_back();
+        }
+    }
+    reverse(order.begin(), order.end());
+    orderIndex.assign(blockList.size(), NO_BLOCK);
+    for (uint32_t i = 0; i < order.size(); ++i) orderIndex[order[i]] = i;
+
+    auto intersect = [&](uint32_t a, uint32_t b) {
+        while (a != b) {
+            while (orderIndex[a] > orderIndex[b]) a = blockList[a].idom;
+            while (orderIndex[b] > orderIndex[a]) b = blockList[b].idom;
+        }
+        return a;
+    };
+    blockList[0].idom = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < order.size(); ++i) {
+            auto& block = blockList[order[i]];
+            uint32_t idom = NO_BLOCK;
+            for (auto pred: block.preds) {
+                if (blockList[pred].idom == NO_BLOCK) continue;
+                idom = idom == NO_BLOCK ? pred : intersect(pred, idom);
+            }
+            if (idom != block.idom) {
+                block.idom = idom;
+                changed = true;
+            }
+        }
+    }
+}
+
+bool Cfg::dominates(uint32_t dominator, uint32_t block) const {
+    if (!reachable(block) || !reachable(dominator)) return false;
+    // dominators come earlier in reverse postorder
+    while (orderIndex[block] > orderIndex[dominator]) block = blockList[block].idom;
+    return block == dominator;
+}
+
+void Cfg::findLoops() {
+    vector<uint32_t> loopOfHeader(blockList.size(), NO_LOOP);
+    vector<bool> inLoop(blockList.size());
+    for (auto header: order) {
+        for (auto latch: blockList[header].preds) {
+            if (!dominates(header, latch)) continue;
+            if (loopOfHeader[header] == NO_LOOP) {
+                loopOfHeader[header] = loopList.size();
+                loopList.push_back({ header, { header }, {}, NO_LOOP });
+            }
+            auto& loop = loopList[loopOfHeader[header]];
+            loop.latches.push_back(latch);
+            for (auto block: loop.blocks) inLoop[block] = true;
+
+            // the body is what reaches the latch backwards without passing the header
+            vector<uint32_t> pending { latch };
+            while (!pending.empty()) {
+                uint32_t block = pending.back();
+                pending.pop_back();
+                if (inLoop[block]) continue;
+                inLoop[block] = true;
+                loop.blocks.push_back(block);
+                for (auto pred: blockList[block].preds) {
+                    if (reachable(pred)) pending.push_back(pred);
+                }
+            }
+            for (auto block: loop.blocks) inLoop[block] = false;
+        }
+    }
+
+    // headers are visited in reverse postorder, so enclosing loops come first
+    for (auto& loop: loopList) sort(loop.blocks.begin(), loop.blocks.end());
+    for (uint32_t i = 0; i < loopList.size(); ++i) {
+        for (uint32_t j = i; j-- > 0;) {
+            auto& outer = loopList[j].blocks;
+            if (binary_search(outer.begin(), outer.end(), loopList[i].header)) {
+                loopList[i].parent = j;
+                break;
+            }
+        }
+    }
+}
+
+uint32_t Cfg::blockOf(size_t index) const {
+    auto found = upper_bound(blockList.begin(), blockList.end(), index,
+        [](size_t index, const BasicBlock& block) { return index < block.first; });
+    if (found == blockList.begin() || index >= (found - 1)->last) return NO_BLOCK;
+    return found - blockList.begin() - 1;
+}
+
+static void printEscaped(ostream& out, const string& text) {
+    for (char c: text) {
+        if (c == '"' || c == '\\') out << '\\';
+        out << c;
+    }
+}
+
+void Cfg::printDot(ostream& out) const {
+    out << "digraph \"";
+    printEscaped(out, functionName());
+    out << "\" {\n\tnode [shape=box, fontname=monospace];\n";
+    for (uint32_t b = 0; b < blockList.size(); ++b) {
+        out << "\tb" << b << " [label=\"";
+        for (size_t i = blockList[b].first; i < blockList[b].last; ++i) {
+            ostringstream tac;
+            code.print(tac, code.tacs[i]);
+            printEscaped(out, tac.str());
+            out << "\\l";
+        }
+        out << '"';
+        if (!reachable(b)) out << ", style=dashed";
+        out << "];\n";
+    }
+    for (uint32_t b = 0; b < blockList.size(); ++b) {
+        for (auto succ: blockList[b].succs) {
+            out << "\tb" << b << " -> b" << succ;
+            // back edges
+            if (dominates(succ, b)) out << " [style=bold]";
+            out << ";\n";
+        }
+    }
+    out << "}\n";
+}
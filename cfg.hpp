@@ -0,0 +1,105 @@
+#ifndef CFG_HPP
+#define CFG_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "tac.hpp"
+
+
+namespace ir {
+
+// instructions entered only at the first of them, and left only after the last one
+struct BasicBlock {
+    size_t first, last;                 // [first, last) in the code
+    std::vector<uint32_t> preds, succs; // indices of blocks, without duplicates
+    uint32_t idom;                      // immediate dominator: the entry itself for the entry, NO_BLOCK if unreachable
+};
+
+// blocks that a back edge to their header repeats, the header included
+struct Loop {
+    uint32_t header;
+    std::vector<uint32_t> blocks;   // in ascending order
+    std::vector<uint32_t> latches;  // sources of the back edges
+    uint32_t parent;                // innermost enclosing loop, or NO_LOOP
+};
+
+/**
+ * Control-flow graph of a single function.
+ * Blocks are split at labels and after jumps and RETURN, and numbered in the order of their instructions,
+ * so the block of the FUNCTION instruction is the entry. Calls do not end blocks, as they return.
+ * The graph refers to the code, and is stale once the code changes.
+ */
+class Cfg {
+public:
+    static constexpr uint32_t NO_BLOCK = UINT32_MAX;
+    static constexpr uint32_t NO_LOOP = UINT32_MAX;
+
+private:
+    const Code& code;
+    std::vector<BasicBlock> blockList;
+    std::vector<uint32_t> order;    // reverse postorder of the reachable blocks
+    std::vector<uint32_t> orderIndex;
+    std::vector<Loop> loopList;
+
+    void split(size_t first, size_t last);
+    void link();
+    void computeDominators();
+    void findLoops();
+
+public:
+    // graph of the instructions [first, last) of code, which begin with FUNCTION
+    Cfg(const Code& code, size_t first, size_t last);
+
+    // graphs of every function in the code
+    static std::vector<Cfg> ofFunctions(const Code& code);
+
+    const Code& getCode() const {
+        return code;
+    }
+
+    std::string functionName() const {
+        return code.tacs[blockList[0].first].result.name().str();
+    }
+
+    const std::vector<BasicBlock>& blocks() const {
+        return blockList;
+    }
+
+    const BasicBlock& operator[](uint32_t block) const {
+        return blockList[block];
+    }
+
+    size_t size() const {
+        return blockList.size();
+    }
+
+    // blocks reachable from the entry, each after all its predecessors but those of back edges
+    const std::vector<uint32_t>& reversePostorder() const {
+        return order;
+    }
+
+    bool reachable(uint32_t block) const {
+        return blockList[block].idom != NO_BLOCK;
+    }
+
+    // whether every path from the entry to `block' goes through `dominator'
+    bool dominates(uint32_t dominator, uint32_t block) const;
+
+    // natural loops, with those sharing a header merged, and each after the loops enclosing it
+    const std::vector<Loop>& loops() const {
+        return loopList;
+    }
+
+    // the block whose instructions include `index', or NO_BLOCK
+    uint32_t blockOf(size_t index) const;
+
+    // the graph in the DOT language of Graphviz, with the instructions of each block
+    void printDot(std::ostream& out) const;
+};
+
+} // namespace ir
+
+#endif // CFG_HPP
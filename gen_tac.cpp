@@ -1,34 +1,86 @@
+#include <exception>
 #include <typeinfo>
+#include <vector>
 #include "ast.hpp"
 #include "gen_tac.hpp"
+#include "worker_pool.hpp"
 
 using namespace ast;
 using namespace ir;
 using namespace std;
 
+static const Ident readFunc("read"), writeFunc("write");
 
-TacGenerator::TacGenerator(ast::Program *ast) {
+
+// functions are translated independently, and then joined in the order of definition
+TacGenerator::TacGenerator(ast::Program *ast, unsigned workers) {
+    vector<FunDef*> funcDefs;
     for (auto definition: ast->extDefs) {
         auto funcDef = dynamic_cast<ast::FunDef*>(definition);
         if (funcDef == nullptr) continue;
-        funcDef->visit(this);
+        funcDefs.push_back(funcDef);
+    }
+    vector<unique_ptr<TacGenerator>> functions(funcDefs.size());
+    vector<exception_ptr> failures(funcDefs.size());
+    parallelFor(funcDefs.size(), workers, [&](size_t i) {
+        try {
+            functions[i].reset(new TacGenerator(funcDefs[i]));
+        } catch (...) {
+            failures[i] = current_exception();
+        }
+    });
+    for (size_t i = 0; i < functions.size(); ++i) {
+        if (failures[i] != nullptr) rethrow_exception(failures[i]);
+        append(*functions[i]);
     }
 }
 
-TacGenerator::~TacGenerator() {
-    for (auto tac: codes) delete tac;
+TacGenerator::TacGenerator(ast::FunDef *funcDef) {
+    funcDef->visit(this);
 }
 
-const list<Tac*>& TacGenerator::getTac() const {
-    return codes;
+// renumbers places, labels and constants of the function as if it were translated after the code so far
+void TacGenerator::append(const TacGenerator& function) {
+    vector<uint32_t> ids(function.placeOwners.size() + 1);
+    for (size_t id = 1; id < ids.size(); ++id) {
+        ids[id] = numberPlace(function.placeOwners[id - 1]);
+    }
+    vector<Operand> constants;
+    for (auto& constant: function.code.constants) {
+        constants.push_back(code.constant(constant));
+    }
+    auto renumber = [&](Operand& operand) {
+        switch (operand.kind()) {
+        case Operand::Kind::TEMP:
+        case Operand::Kind::VARIABLE:
+            operand = operand.withValue(ids[operand.value()]);
+            break;
+        case Operand::Kind::CONSTANT:
+            operand = constants[operand.value()];
+            break;
+        case Operand::Kind::LABEL:
+            operand = operand.withValue(operand.value() + labelSeq);
+            break;
+        default:
+            break;
+        }
+    };
+    code.tacs.reserve(code.tacs.size() + function.code.tacs.size());
+    for (auto tac: function.code.tacs) {
+        renumber(tac.result);
+        renumber(tac.arg1);
+        renumber(tac.arg2);
+        code.tacs.push_back(tac);
+    }
+    labelSeq += function.labelSeq;
 }
 
 // TODO: handle non-integer arguments
 void TacGenerator::visit(FunDef *self) {
-    *this << new FuncTac(self->declarator->identifier);
+    emit(Opcode::FUNCTION, Operand::function(self->declarator->identifier));
     for (auto param: self->declarator->parameters) {
-        auto place = makeTacOp<VariableOperand>(param->scope->getId(param->declarator->identifier));
-        *this << new ParamTac(place);
+        auto place = placeOf(param->declarator->symbol);
+        emit(Opcode::PARAM, place);
     }
     self->body->visit(this);
 }
@@ -36,35 +88,35 @@ void TacGenerator::visit(FunDef *self) {
 void TacGenerator::visit(Def *self) {
     for (auto dec: self->declarations) {
         if (dec->init != nullptr) {
-            auto variable = makeTacOp<VariableOperand>(self->scope->getId(dec->declarator->identifier));
-            auto tp = makeTacOp<VariableOperand>(self->scope->createPlace());
+            auto variable = placeOf(dec->declarator->symbol);
+            auto tp = createPlace();
             translate(dec->init, tp);
-            *this << new AssignTac(variable, tp);
+            emit(Opcode::ASSIGN, variable, tp);
         }
     }
 }
 
 void TacGenerator::visit(LiteralExp *self) {
-    shared_ptr<TacOperand> value;
+    Operand value;
     switch (smt::as<smt::PrimitiveType>(self->type).primitive) {
     case smt::Primitive::INT:
-        value = makeTacOp<ConstantOperand<int>>(self->intVal);
+        value = code.constant(Constant::ofInt(self->intVal));
         break;
     case smt::Primitive::CHAR:
-        value = makeTacOp<ConstantOperand<char>>(self->charVal);
+        value = code.constant(Constant::ofChar(self->charVal));
         break;
     case smt::Primitive::FLOAT:
-        value = makeTacOp<ConstantOperand<float>>(self->floatVal);
+        value = code.constant(Constant::ofFloat(self->floatVal));
         break;
     default:
         throw invalid_argument("invalid type");
     }
-    *this << new AssignTac(retrievePlace(), value);
+    emit(Opcode::ASSIGN, retrievePlace(), value);
 }
 
 void TacGenerator::visit(IdExp *self) {
-    auto variable = makeTacOp<VariableOperand>(self->scope->getId(self->identifier));
-    *this << new AssignTac(retrievePlace(), variable);
+    auto variable = placeOf(self->symbol);
+    emit(Opcode::ASSIGN, retrievePlace(), variable);
 }
 
 void TacGenerator::visit(UnaryExp *self) {
@@ -72,12 +124,12 @@ void TacGenerator::visit(UnaryExp *self) {
     if (self->opt == Operator::NOT) {
         translateCondExp(self, place);
     } else {
-        auto tp = makeTacOp<VariableOperand>(self->scope->createPlace());
+        auto tp = createPlace();
         translate(self->argument, tp);
         if (self->opt == Operator::MINUS) {
-            *this << new SubTac(place, makeTacOp<ConstantOperand<int>>(0), tp);
+            emit(Opcode::SUB, place, code.constant(Constant::ofInt(0)), tp);
         } else if (self->opt == Operator::PLUS) {
-            *this << new AssignTac(place, tp);
+            emit(Opcode::ASSIGN, place, tp);
         } else {
             throw runtime_error("invalid unary operator encountered");
         }
@@ -98,22 +150,22 @@ void TacGenerator::visit(BinaryExp *self) {
         translateCondExp(self, place);
         break;
     default: {
-        auto t1 = makeTacOp<VariableOperand>(self->scope->createPlace());
-        auto t2 = makeTacOp<VariableOperand>(self->scope->createPlace());
+        auto t1 = createPlace();
+        auto t2 = createPlace();
         translate(self->left, t1);
         translate(self->right, t2);
         switch (self->opt) {
         case Operator::PLUS:
-            *this << new AddTac(place, t1, t2);
+            emit(Opcode::ADD, place, t1, t2);
             break;
         case Operator::MINUS:
-            *this << new SubTac(place, t1, t2);
+            emit(Opcode::SUB, place, t1, t2);
             break;
         case Operator::MUL:
-            *this << new MulTac(place, t1, t2);
+            emit(Opcode::MUL, place, t1, t2);
             break;
         case Operator::DIV:
-            *this << new DivTac(place, t1, t2);
+            emit(Opcode::DIV, place, t1, t2);
             break;
         default:
             throw runtime_error("Invalid binary operator");
@@ -129,10 +181,11 @@ void TacGenerator::visit(AssignExp *self) {
         throw runtime_error("assignment to non-IdExp has not been implemented");
     }
     // TODO: support assignment of non-integer values
-    auto variable = makeTacOp<VariableOperand>(self->scope->getId(lvalue->identifier));
-    auto tp = makeTacOp<VariableOperand>(self->scope->createPlace());
+    auto variable = placeOf(lvalue->symbol);
+    auto tp = createPlace();
     translate(self->right, tp);
-    *this << new AssignTac(variable, tp) << new AssignTac(place, variable);
+    emit(Opcode::ASSIGN, variable, tp);
+    emit(Opcode::ASSIGN, place, variable);
 }
 
 void TacGenerator::visit(ArrayExp *self) {
@@ -147,65 +200,66 @@ void TacGenerator::visit(MemberExp *self) {
 // TODO: enforce argument number for built-in I/O functions during semantic analysis
 void TacGenerator::visit(CallExp *self) {
     auto place = retrievePlace();
-    if (self->identifier == "read") {
-        *this << new ReadTac(place);
-    } else if (self->identifier == "write") {
-        auto tp = makeTacOp<VariableOperand>(self->scope->createPlace());
+    if (self->identifier == readFunc) {
+        emit(Opcode::READ, place);
+    } else if (self->identifier == writeFunc) {
+        auto tp = createPlace();
         translate(self->arguments[0], tp);
-        *this << new WriteTac(tp);
+        emit(Opcode::WRITE, {}, tp);
     } else {
-        vector<shared_ptr<TacOperand>> argPlaces;
+        vector<Operand> argPlaces;
         // left-to-right evaluation
         for (auto arg: self->arguments) {
-            auto argPlace = makeTacOp<VariableOperand>(self->scope->createPlace());
+            auto argPlace = createPlace();
             translate(arg, argPlace);
             argPlaces.push_back(argPlace);
         }
         // push args into stack from right to left
         for (auto argPlace = argPlaces.rbegin(); argPlace != argPlaces.rend(); ++argPlace) {
-            *this << new ArgTac(*argPlace);
+            emit(Opcode::ARG, {}, *argPlace);
         }
-        *this << new CallTac(place, self->identifier);
+        emit(Opcode::CALL, place, Operand::function(self->identifier));
     }
 }
 
 void TacGenerator::visit(ExpStmt *self) {
-    auto tp = makeTacOp<VariableOperand>(self->scope->createPlace());
+    auto tp = createPlace();
     translate(self->expression, tp);
 }
 
 void TacGenerator::visit(ReturnStmt *self) {
-    auto tp = makeTacOp<VariableOperand>(self->scope->createPlace());
+    auto tp = createPlace();
     translate(self->argument, tp);
-    *this << new ReturnTac(tp);
+    emit(Opcode::RETURN, {}, tp);
 }
 
 void TacGenerator::visit(IfStmt *self) {
-    LabelTac *label1, *label2, *label3;
-    label1 = new LabelTac(self->scope->createLabel());
-    label2 = new LabelTac(self->scope->createLabel());
+    auto label1 = createLabel();
+    auto label2 = createLabel();
     translateCondExp(self->test, label1, label2);
-    *this << label1;
+    emit(Opcode::LABEL, label1);
     self->consequent->visit(this);
     if (self->alternate != nullptr) {
-        label3 = new LabelTac(self->scope->createLabel());
-        *this << new GotoTac(label3->no) << label2;
+        auto label3 = createLabel();
+        emit(Opcode::GOTO, label3);
+        emit(Opcode::LABEL, label2);
         self->alternate->visit(this);
-        *this << label3;
+        emit(Opcode::LABEL, label3);
     } else {
-        *this << label2;
+        emit(Opcode::LABEL, label2);
     }
 }
 
 void TacGenerator::visit(WhileStmt *self) {
-    auto label1 = new LabelTac(self->scope->createLabel());
-    auto label2 = new LabelTac(self->scope->createLabel());
-    auto label3 = new LabelTac(self->scope->createLabel());
-    *this << label1;
+    auto label1 = createLabel();
+    auto label2 = createLabel();
+    auto label3 = createLabel();
+    emit(Opcode::LABEL, label1);
     translateCondExp(self->test, label2, label3);
-    *this << label2;
+    emit(Opcode::LABEL, label2);
     self->body->visit(this);
-    *this << new GotoTac(label1->no) << label3;
+    emit(Opcode::GOTO, label1);
+    emit(Opcode::LABEL, label3);
 }
 
 void TacGenerator::visit(ForStmt *self) {
@@ -221,65 +275,68 @@ void TacGenerator::visit(CompoundStmt *self) {
     }
 }
 
-void TacGenerator::translateCondExp(const Exp *exp, LabelTac *labelTrue, LabelTac *labelFalse) {
+void TacGenerator::translateCondExp(const Exp *exp, Operand labelTrue, Operand labelFalse) {
     if (typeid(*exp) == typeid(UnaryExp)) {
         translateCondExp(exp, labelFalse, labelTrue);
     } else {
         const auto *binExp = dynamic_cast<const BinaryExp*>(exp);
         if (binExp == nullptr) {
-            throw invalid_argument("invalid expression"); // FIXME: memory leak
+            throw invalid_argument("invalid expression");
         }
         switch (binExp->opt) {
         case Operator::AND: {
-            auto label1 = new LabelTac(exp->scope->createLabel());
+            auto label1 = createLabel();
             translateCondExp(binExp->left, label1, labelFalse);
-            *this << label1;
+            emit(Opcode::LABEL, label1);
             translateCondExp(binExp->right, labelTrue, labelFalse);
         } break;
         case Operator::OR: {
-            auto label1 = new LabelTac(exp->scope->createLabel());
+            auto label1 = createLabel();
             translateCondExp(binExp->left, labelTrue, label1);
-            *this << label1;
+            emit(Opcode::LABEL, label1);
             translateCondExp(binExp->right, labelTrue, labelFalse);
         } break;
         default: {
-            auto t1 = makeTacOp<VariableOperand>(exp->scope->createPlace());
-            auto t2 = makeTacOp<VariableOperand>(exp->scope->createPlace());
+            auto t1 = createPlace();
+            auto t2 = createPlace();
             translate(binExp->left, t1);
             translate(binExp->right, t2);
-            IfGotoTac *ifGotoTac;
+            Opcode branch;
             switch (binExp->opt) {
             case Operator::LT:
-                ifGotoTac = new IfLtGotoTac(t1, t2, labelTrue->no);
+                branch = Opcode::IF_LT;
                 break;
             case Operator::LE:
-                ifGotoTac = new IfLeGotoTac(t1, t2, labelTrue->no);
+                branch = Opcode::IF_LE;
                 break;
             case Operator::GT:
-                ifGotoTac = new IfGtGotoTac(t1, t2, labelTrue->no);
+                branch = Opcode::IF_GT;
                 break;
             case Operator::GE:
-                ifGotoTac = new IfGeGotoTac(t1, t2, labelTrue->no);
+                branch = Opcode::IF_GE;
                 break;
             case Operator::NE:
-                ifGotoTac = new IfNeGotoTac(t1, t2, labelTrue->no);
+                branch = Opcode::IF_NE;
                 break;
             case Operator::EQ:
-                ifGotoTac = new IfEqGotoTac(t1, t2, labelTrue->no);
+                branch = Opcode::IF_EQ;
                 break;
             default:
                 throw runtime_error("invalid binary expression");
             }
-            *this << ifGotoTac << new GotoTac(labelFalse->no);
+            emit(branch, labelTrue, t1, t2);
+            emit(Opcode::GOTO, labelFalse);
         }
         }
     }
 }
 
-void TacGenerator::translateCondExp(const Exp *exp, std::shared_ptr<TacOperand> place) {
-    auto label1 = new LabelTac(exp->scope->createLabel());
-    auto label2 = new LabelTac(exp->scope->createLabel());
-    *this << new AssignTac(place, makeTacOp<ConstantOperand<int>>(0));
+void TacGenerator::translateCondExp(const Exp *exp, Operand place) {
+    auto label1 = createLabel();
+    auto label2 = createLabel();
+    emit(Opcode::ASSIGN, place, code.constant(Constant::ofInt(0)));
     translateCondExp(exp, label1, label2);
-    *this << label1 << new AssignTac(place, makeTacOp<ConstantOperand<int>>(1)) << label2;
+    emit(Opcode::LABEL, label1);
+    emit(Opcode::ASSIGN, place, code.constant(Constant::ofInt(1)));
+    emit(Opcode::LABEL, label2);
 }
@@ -1,10 +1,11 @@
 #ifndef GEN_TAC_HPP
 #define GEN_TAC_HPP
 
-#include <list>
+#include <algorithm>
 #include <memory>
-#include <ostream>
 #include <stack>
+#include <unordered_map>
+#include <vector>
 #include "tac.hpp"
 #include "ast.hpp"
 
@@ -13,38 +14,81 @@ namespace ir {
 
 class TacGenerator final: public ast::Visitor {
 private:
-    std::list<Tac*> codes;
-    std::stack<std::shared_ptr<TacOperand>> places;
+    Code code;
+    std::stack<Operand> places;
 
-    std::shared_ptr<TacOperand> retrievePlace() {
+    // variables and temporaries are numbered from the same sequence, in order of first use
+    int labelSeq = 0;
+    std::vector<const smt::Symbol*> placeOwners;    // symbol of each numbered place, or nullptr for temporaries
+    std::unordered_map<const smt::Symbol*, int> symbolIds;
+
+    explicit TacGenerator(ast::FunDef *);   // translates a single function
+    void append(const TacGenerator& function);
+
+    int numberPlace(const smt::Symbol *symbol) {
+        if (symbol != nullptr) {
+            auto found = symbolIds.find(symbol);
+            if (found != symbolIds.end()) return found->second;
+        }
+        placeOwners.push_back(symbol);
+        int id = placeOwners.size();
+        if (symbol != nullptr) symbolIds[symbol] = id;
+        return id;
+    }
+
+    Operand createPlace() {
+        return Operand::temp(numberPlace(nullptr));
+    }
+
+    Operand placeOf(const smt::Symbol *symbol) {
+        return Operand::variable(numberPlace(symbol));
+    }
+
+    Operand createLabel() {
+        return Operand::label(++labelSeq);
+    }
+
+    Operand retrievePlace() {
         auto place = places.top();
         places.pop();
         return place;
     }
 
-    TacGenerator& operator<<(Tac* tac) {
-        codes.push_back(tac);
-        return *this;
+    void emit(Opcode op, Operand result, Operand arg1 = {}, Operand arg2 = {}) {
+        code.tacs.push_back({ op, result, arg1, arg2 });
     }
 
-    TacGenerator& operator<<(std::list<Tac*>&& tacs) {
-        codes.splice(codes.end(), tacs);
-        return *this;
-    }
-
-    void translate(ast::Exp *node, std::shared_ptr<TacOperand> place) {
-        places.emplace(std::move(place));
+    void translate(ast::Exp *node, Operand place) {
+        places.push(place);
         node->visit(this);
     }
 
-    void translateCondExp(const ast::Exp *exp, ir::LabelTac *labelTrue, ir::LabelTac *labelFalse);
-    void translateCondExp(const ast::Exp *exp, std::shared_ptr<TacOperand> place);
+    void translateCondExp(const ast::Exp *exp, Operand labelTrue, Operand labelFalse);
+    void translateCondExp(const ast::Exp *exp, Operand place);
 
 public:
-    explicit TacGenerator(ast::Program *ast);
-    ~TacGenerator() override;
+    // functions are translated on up to `workers' threads, with the same result as a single one
+    explicit TacGenerator(ast::Program *ast, unsigned workers = 1);
+
+    const Code& getTac() const {
+        return code;
+    }
+
+    Code& getTac() {
+        return code;
+    }
 
-    const std::list<Tac*>& getTac() const;
+    size_t tempCount() const {
+        return std::count(placeOwners.begin(), placeOwners.end(), nullptr);
+    }
+
+    size_t variableCount() const {
+        return placeOwners.size() - tempCount();
+    }
+
+    size_t labelCount() const {
+        return labelSeq;
+    }
 
     void visit(ast::FunDef *) override;
     void visit(ast::Def *) override;
@@ -0,0 +1,103 @@
+#ifndef IDENT_HPP
+#define IDENT_HPP
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * Handle of a name interned in a process-wide pool.
+ * Equal names share a handle, so that they can be hashed and compared as integers;
+ * the text is only looked up when printing diagnostics or IR.
+ */
+class Ident {
+private:
+    struct Pool {
+        std::shared_mutex mutex;
+        std::deque<std::string> names;  // never shrinks, so references stay valid
+        std::unordered_map<std::string_view, uint32_t> ids;
+    };
+
+    static Pool& pool() {
+        static Pool instance;
+        return instance;
+    }
+
+    uint32_t id;
+
+public:
+    Ident() = default;  // trivial, since tokens carry identifiers in the parser's value union
+
+    Ident(std::string_view name): id(intern(name)) {}
+    Ident(const char *name): Ident(std::string_view(name)) {}
+    Ident(const std::string& name): Ident(std::string_view(name)) {}
+
+    // handle of an interned name, e.g. one kept in IR as its value
+    static Ident fromValue(uint32_t value) {
+        Ident ident;
+        ident.id = value;
+        return ident;
+    }
+
+    static uint32_t intern(std::string_view name) {
+        Pool& p = pool();
+        {
+            std::shared_lock<std::shared_mutex> lock(p.mutex);
+            auto found = p.ids.find(name);
+            if (found != p.ids.end()) return found->second;
+        }
+        std::unique_lock<std::shared_mutex> lock(p.mutex);
+        auto found = p.ids.find(name);
+        if (found != p.ids.end()) return found->second;
+        auto newId = static_cast<uint32_t>(p.names.size());
+        p.ids.emplace(p.names.emplace_back(name), newId);
+        return newId;
+    }
+
+    const std::string& str() const {
+        Pool& p = pool();
+        std::shared_lock<std::shared_mutex> lock(p.mutex);
+        return p.names[id];
+    }
+
+    uint32_t value() const {
+        return id;
+    }
+
+    bool operator==(Ident other) const {
+        return id == other.id;
+    }
+
+    bool operator!=(Ident other) const {
+        return id != other.id;
+    }
+
+    bool operator==(const char *name) const {
+        return str() == name;
+    }
+
+    bool operator!=(const char *name) const {
+        return str() != name;
+    }
+};
+
+inline std::ostream& operator<<(std::ostream& out, Ident ident) {
+    return out << ident.str();
+}
+
+namespace std {
+template<>
+struct hash<Ident> {
+    size_t operator()(Ident ident) const {
+        return ident.value();
+    }
+};
+}
+
+#endif // IDENT_HPP
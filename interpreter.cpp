@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include "interpreter.hpp"
+
+// GCC and Clang jump straight from one handler to the next through a table of label addresses
+#if defined(__GNUC__) && !defined(SPLC_SWITCH_DISPATCH)
+#define SPLC_THREADED_DISPATCH 1
+#endif
+
+using namespace ir;
+using namespace std;
+
+
+Interpreter::Interpreter(const Code& source, size_t stackWords): stackWords(stackWords) {
+    decode(source);
+}
+
+void Interpreter::decode(const Code& source) {
+    unordered_map<uint32_t, uint32_t> functionIds;     // by the value of the name
+    for (auto& tac: source.tacs) {
+        if (tac.op != Opcode::FUNCTION) continue;
+        if (!functionIds.emplace(tac.result.value(), functions.size()).second) {
+            throw runtime_error("function " + tac.result.name().str() + " is defined twice");
+        }
+        functions.push_back({ tac.result.name(), 0, 0, 0, {} });
+    }
+    auto foundMain = functionIds.find(Ident("main").value());
+    if (foundMain == functionIds.end()) throw runtime_error("no function main");
+    mainFunc = foundMain->second;
+    if (!source.tacs.empty() && source.tacs.front().op != Opcode::FUNCTION) {
+        throw runtime_error("code outside of functions");
+    }
+
+    unordered_map<uint32_t, uint32_t> labels;   // by number, to the index of the next instruction
+    vector<pair<size_t, uint32_t>> jumps;       // instructions to be pointed at their labels
+    size_t next = 0;
+    for (auto& function: functions) {
+        size_t end = next + 1;
+        while (end < source.tacs.size() && source.tacs[end].op != Opcode::FUNCTION) ++end;
+
+        // arrays take the words declared by DEC, and other places a single word
+        unordered_map<uint32_t, uint32_t> sizes;
+        for (size_t i = next + 1; i < end; ++i) {
+            auto& tac = source.tacs[i];
+            if (tac.op == Opcode::DEC) sizes[tac.result.value()] = max<int32_t>(1, (source.constantOf(tac.arg1).intVal + 3) / 4);
+        }
+        unordered_map<uint32_t, int32_t> slots;
+        unordered_map<uint32_t, int32_t> constantSlots;
+        uint32_t frameSize = 0;
+        auto slot = [&](Operand operand) -> int32_t {
+            if (!operand.isPlace()) throw runtime_error("expected a place in function " + function.name.str());
+            auto inserted = slots.emplace(operand.value(), frameSize);
+            if (inserted.second) {
+                auto size = sizes.find(operand.value());
+                frameSize += size == sizes.end() ? 1 : size->second;
+            }
+            return inserted.first->second;
+        };
+        // constants are numbered as -1, -2, ... until the frame size is known
+        auto value = [&](Operand operand) -> int32_t {
+            if (operand.kind() != Operand::Kind::CONSTANT) return slot(operand);
+            auto& constant = source.constantOf(operand);
+            if (constant.type == Constant::Type::FLOAT) throw runtime_error("floating-point values are not supported");
+            auto inserted = constantSlots.emplace(operand.value(), -1 - static_cast<int32_t>(function.constants.size()));
+            if (inserted.second) function.constants.push_back(constant.intVal);
+            return inserted.first->second;
+        };
+
+        function.entry = code.size();
+        for (size_t i = next + 1; i < end; ++i) {
+            auto& tac = source.tacs[i];
+            auto emit = [&](Op op, int32_t a, int32_t b = 0, int32_t c = 0) {
+                code.push_back({ op, a, b, c });
+            };
+            auto jump = [&](Op op, int32_t b = 0, int32_t c = 0) {
+                jumps.emplace_back(code.size(), tac.result.value());
+                emit(op, 0, b, c);
+            };
+            switch (tac.op) {
+            case Opcode::LABEL:
+                labels[tac.result.value()] = code.size();
+                break;
+            case Opcode::DEC:
+                slot(tac.result);
+                break;
+            case Opcode::ASSIGN: emit(Op::ASSIGN, slot(tac.result), value(tac.arg1)); break;
+            case Opcode::ADD: emit(Op::ADD, slot(tac.result), value(tac.arg1), value(tac.arg2)); break;
+            case Opcode::SUB: emit(Op::SUB, slot(tac.result), value(tac.arg1), value(tac.arg2)); break;
+            case Opcode::MUL: emit(Op::MUL, slot(tac.result), value(tac.arg1), value(tac.arg2)); break;
+            case Opcode::DIV: emit(Op::DIV, slot(tac.result), value(tac.arg1), value(tac.arg2)); break;
+            case Opcode::ADDR: emit(Op::ADDR, slot(tac.result), slot(tac.arg1)); break;
+            case Opcode::FETCH: emit(Op::FETCH, slot(tac.result), value(tac.arg1)); break;
+            case Opcode::DEREF: emit(Op::DEREF, value(tac.result), value(tac.arg1)); break;
+            case Opcode::GOTO: jump(Op::GOTO); break;
+            case Opcode::IF_LT: jump(Op::IF_LT, value(tac.arg1), value(tac.arg2)); break;
+            case Opcode::IF_LE: jump(Op::IF_LE, value(tac.arg1), value(tac.arg2)); break;
+            case Opcode::IF_GT: jump(Op::IF_GT, value(tac.arg1), value(tac.arg2)); break;
+            case Opcode::IF_GE: jump(Op::IF_GE, value(tac.arg1), value(tac.arg2)); break;
+            case Opcode::IF_NE: jump(Op::IF_NE, value(tac.arg1), value(tac.arg2)); break;
+            case Opcode::IF_EQ: jump(Op::IF_EQ, value(tac.arg1), value(tac.arg2)); break;
+            case Opcode::RETURN: emit(Op::RETURN, 0, value(tac.arg1)); break;
+            case Opcode::PARAM: emit(Op::PARAM, slot(tac.result)); break;
+            case Opcode::ARG: emit(Op::ARG, 0, value(tac.arg1)); break;
+            case Opcode::CALL: {
+                auto callee = functionIds.find(tac.arg1.value());
+                if (callee == functionIds.end()) throw runtime_error("call to undefined function " + tac.arg1.name().str());
+                emit(Op::CALL, slot(tac.result), callee->second);
+            } break;
+            case Opcode::READ: emit(Op::READ, slot(tac.result)); break;
+            case Opcode::WRITE: emit(Op::WRITE, 0, value(tac.arg1)); break;
+            case Opcode::FUNCTION:
+                break;
+            }
+        }
+        code.push_back({ Op::FALL_OFF, static_cast<int32_t>(&function - functions.data()), 0, 0 });
+
+        function.constantBase = frameSize;
+        function.frameSize = frameSize + function.constants.size();
+        for (size_t i = function.entry; i < code.size(); ++i) {
+            auto& instruction = code[i];
+            for (int32_t *field: { &instruction.a, &instruction.b, &instruction.c }) {
+                if (*field < 0) *field = frameSize - 1 - *field;
+            }
+        }
+        next = end;
+    }
+
+    for (auto& jump: jumps) {
+        auto target = labels.find(jump.second);
+        if (target == labels.end()) throw runtime_error("jump to undefined label" + to_string(jump.second));
+        code[jump.first].a = target->second;
+    }
+}
+
+
+int32_t Interpreter::run(istream& in, ostream& out) {
+    struct Frame {
+        const Instruction *ret;     // to continue the caller
+        uint32_t base;
+        int32_t result;
+        uint32_t function;
+    };
+    unique_ptr<int32_t[]> stack(new int32_t[stackWords]);
+    vector<Frame> frames;
+    vector<int32_t> args, params;
+    uint64_t count = 0;
+    const uint64_t limit = stepLimit;
+    const Instruction *start = code.data();
+
+    uint32_t base = 0, func = mainFunc;
+    auto enter = [&]() -> int32_t* {
+        auto& function = functions[func];
+        if (base + function.frameSize > stackWords) throw runtime_error("stack overflow");
+        int32_t *frame = stack.get() + base;
+        fill(frame, frame + function.constantBase, 0);
+        copy(function.constants.begin(), function.constants.end(), frame + function.constantBase);
+        return frame;
+    };
+    auto word = [&](int32_t address) -> int32_t& {
+        if (address < 0 || address % 4 != 0 || static_cast<size_t>(address / 4) >= stackWords) {
+            throw runtime_error("invalid address " + to_string(address));
+        }
+        return stack[address / 4];
+    };
+    // 32-bit arithmetic wraps around
+    auto wrap = [](int64_t value) {
+        return static_cast<int32_t>(static_cast<uint32_t>(value));
+    };
+
+    int32_t *fp = enter();
+    const Instruction *ip = start + functions[func].entry;
+
+    try {
+#ifdef SPLC_THREADED_DISPATCH
+        static const void * const handlers[] = {
+            &&do_ASSIGN, &&do_ADD, &&do_SUB, &&do_MUL, &&do_DIV, &&do_ADDR, &&do_FETCH, &&do_DEREF,
+            &&do_GOTO, &&do_IF_LT, &&do_IF_LE, &&do_IF_GT, &&do_IF_GE, &&do_IF_NE, &&do_IF_EQ,
+            &&do_RETURN, &&do_PARAM, &&do_ARG, &&do_CALL, &&do_READ, &&do_WRITE,
+            &&do_FALL_OFF,
+        };
+#define DISPATCH() do { if (++count > limit) goto step_limit; goto *handlers[static_cast<int>(ip->op)]; } while (0)
+#define CASE(op) do_##op:
+#define NEXT() do { ++ip; DISPATCH(); } while (0)
+#define JUMP_TO(target) do { ip = start + (target); DISPATCH(); } while (0)
+        DISPATCH();
+#else
+#define CASE(op) case Op::op:
+#define NEXT() { ++ip; continue; }
+#define JUMP_TO(target) { ip = start + (target); continue; }
+        for (;;) {
+            if (++count > limit) goto step_limit;
+            switch (ip->op) {
+#endif
+        CASE(ASSIGN) fp[ip->a] = fp[ip->b]; NEXT();
+        CASE(ADD) fp[ip->a] = wrap(int64_t(fp[ip->b]) + fp[ip->c]); NEXT();
+        CASE(SUB) fp[ip->a] = wrap(int64_t(fp[ip->b]) - fp[ip->c]); NEXT();
+        CASE(MUL) fp[ip->a] = wrap(int64_t(fp[ip->b]) * fp[ip->c]); NEXT();
+        CASE(DIV)
+            if (fp[ip->c] == 0) throw runtime_error("division by zero");
+            fp[ip->a] = wrap(int64_t(fp[ip->b]) / fp[ip->c]);
+            NEXT();
+        CASE(ADDR) fp[ip->a] = (base + ip->b) * 4; NEXT();
+        CASE(FETCH) fp[ip->a] = word(fp[ip->b]); NEXT();
+        CASE(DEREF) word(fp[ip->a]) = fp[ip->b]; NEXT();
+        CASE(GOTO) JUMP_TO(ip->a);
+        CASE(IF_LT) if (fp[ip->b] < fp[ip->c]) JUMP_TO(ip->a); NEXT();
+        CASE(IF_LE) if (fp[ip->b] <= fp[ip->c]) JUMP_TO(ip->a); NEXT();
+        CASE(IF_GT) if (fp[ip->b] > fp[ip->c]) JUMP_TO(ip->a); NEXT();
+        CASE(IF_GE) if (fp[ip->b] >= fp[ip->c]) JUMP_TO(ip->a); NEXT();
+        CASE(IF_NE) if (fp[ip->b] != fp[ip->c]) JUMP_TO(ip->a); NEXT();
+        CASE(IF_EQ) if (fp[ip->b] == fp[ip->c]) JUMP_TO(ip->a); NEXT();
+        CASE(RETURN) {
+            int32_t value = fp[ip->b];
+            if (frames.empty()) {
+                steps = count;
+                return value;
+            }
+            auto caller = frames.back();
+            frames.pop_back();
+            base = caller.base;
+            func = caller.function;
+            fp = stack.get() + base;
+            fp[caller.result] = value;
+            JUMP_TO(caller.ret - start);
+        }
+        CASE(PARAM)
+            if (params.empty()) throw runtime_error("too few arguments for " + functions[func].name.str());
+            fp[ip->a] = params.back();
+            params.pop_back();
+            NEXT();
+        CASE(ARG) args.push_back(fp[ip->b]); NEXT();
+        CASE(CALL)
+            frames.push_back({ ip + 1, base, ip->a, func });
+            base += functions[func].frameSize;
+            func = ip->b;
+            fp = enter();
+            // arguments were pushed from right to left, so the first parameter takes the last one
+            params.swap(args);
+            args.clear();
+            JUMP_TO(functions[func].entry);
+        CASE(READ)
+            if (!(in >> fp[ip->a])) throw runtime_error("no more input to read");
+            NEXT();
+        CASE(WRITE) out << fp[ip->b] << '\n'; NEXT();
+        CASE(FALL_OFF) throw runtime_error("function " + functions[ip->a].name.str() + " ends without RETURN");
+#ifndef SPLC_THREADED_DISPATCH
+            }
+        }
+#endif
+#undef CASE
+#undef NEXT
+#undef JUMP_TO
+#undef DISPATCH
+
+step_limit:
+        throw runtime_error("step limit exceeded");
+    } catch (...) {
+        steps = count;
+        throw;
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef INTERPRETER_HPP
+#define INTERPRETER_HPP
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <vector>
+#include "tac.hpp"
+
+
+namespace ir {
+
+/**
+ * Executes integer IR, starting from `main'.
+ * The code is decoded once: labels become instruction indices, callees become function indices,
+ * and every operand becomes an offset into the frame of its function, where constants are
+ * copied on each call, so that the dispatch loop never looks at operand kinds.
+ * Memory is a stack of 32-bit words; addresses are byte offsets into it, as in `DEC v 8' and `&v'.
+ * Errors (division by zero, bad addresses, running out of input or of the step limit) throw
+ * std::runtime_error.
+ */
+class Interpreter final {
+public:
+    enum class Op: uint8_t {
+        ASSIGN, ADD, SUB, MUL, DIV, ADDR, FETCH, DEREF,
+        GOTO, IF_LT, IF_LE, IF_GT, IF_GE, IF_NE, IF_EQ,
+        RETURN, PARAM, ARG, CALL, READ, WRITE,
+        FALL_OFF,   // past the end of a function
+    };
+
+    // `a := b op c', with jump targets in `a', and callees in `b'
+    struct Instruction {
+        Op op;
+        int32_t a, b, c;
+    };
+
+    struct Function {
+        Ident name;
+        uint32_t entry;
+        uint32_t frameSize;     // in words, including constants
+        uint32_t constantBase;  // offset of the constants in the frame
+        std::vector<int32_t> constants;
+    };
+
+private:
+    std::vector<Instruction> code;
+    std::vector<Function> functions;
+    uint32_t mainFunc;
+    size_t stackWords;
+    uint64_t stepLimit = UINT64_MAX;
+    uint64_t steps = 0;
+
+    void decode(const Code& source);
+
+public:
+    explicit Interpreter(const Code& source, size_t stackWords = 1 << 22);
+
+    // steps beyond the limit throw, e.g. to stop programs that never end
+    void setStepLimit(uint64_t limit) {
+        stepLimit = limit;
+    }
+
+    // runs `main' with its input and output, and returns what it returns
+    int32_t run(std::istream& in, std::ostream& out);
+
+    // instructions executed by the last run
+    uint64_t executed() const {
+        return steps;
+    }
+
+    const std::vector<Instruction>& instructions() const {
+        return code;
+    }
+};
+
+} // namespace ir
+
+#endif // INTERPRETER_HPP
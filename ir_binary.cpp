@@ -0,0 +1,204 @@
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include "ir_binary.hpp"
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SPLC_HAS_MMAP 1
+#endif
+
+using namespace ir;
+using namespace ir::binary;
+using namespace std;
+
+
+static uint32_t alignSection(size_t offset) {
+    return (offset + 7) & ~size_t(7);
+}
+
+void ir::writeBinaryIr(ostream& out, const Code& code) {
+    // names of functions, each stored once
+    string strings;
+    unordered_map<uint32_t, uint32_t> nameOffsets;
+    auto nameOffset = [&](Operand operand) {
+        auto inserted = nameOffsets.emplace(operand.value(), strings.size());
+        if (inserted.second) {
+            strings += operand.name().str();
+            strings += '\0';
+        }
+        return inserted.first->second;
+    };
+
+    vector<Tac> tacs(code.tacs.begin(), code.tacs.end());
+    vector<FunctionEntry> functions;
+    for (size_t i = 0; i < tacs.size(); ++i) {
+        for (Operand *operand: { &tacs[i].result, &tacs[i].arg1, &tacs[i].arg2 }) {
+            if (operand->kind() == Operand::Kind::FUNCTION) *operand = operand->withValue(nameOffset(*operand));
+        }
+        if (tacs[i].op == Opcode::FUNCTION) {
+            if (!functions.empty()) functions.back().count = i - functions.back().first;
+            functions.push_back({ tacs[i].result.value(), static_cast<uint32_t>(i), 0 });
+        }
+    }
+    if (!functions.empty()) functions.back().count = tacs.size() - functions.back().first;
+
+    Header header {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrder = ENDIAN_MARK;
+    header.tacCount = tacs.size();
+    header.functionCount = functions.size();
+    header.constantCount = code.constants.size();
+    header.stringSize = strings.size();
+    header.tacOffset = alignSection(sizeof(Header));
+    header.functionOffset = alignSection(header.tacOffset + tacs.size() * sizeof(Tac));
+    header.constantOffset = alignSection(header.functionOffset + functions.size() * sizeof(FunctionEntry));
+    header.stringOffset = alignSection(header.constantOffset + code.constants.size() * sizeof(Constant));
+
+    // records are copied field by field, so that no padding of the host leaks into the file
+    vector<char> file(header.stringOffset + strings.size(), 0);
+    memcpy(file.data(), &header, sizeof(header));
+    char *tacOut = file.data() + header.tacOffset;
+    for (auto& tac: tacs) {
+        memcpy(tacOut + offsetof(Tac, op), &tac.op, sizeof(tac.op));
+        memcpy(tacOut + offsetof(Tac, result), &tac.result, sizeof(Operand));
+        memcpy(tacOut + offsetof(Tac, arg1), &tac.arg1, sizeof(Operand));
+        memcpy(tacOut + offsetof(Tac, arg2), &tac.arg2, sizeof(Operand));
+        tacOut += sizeof(Tac);
+    }
+    memcpy(file.data() + header.functionOffset, functions.data(), functions.size() * sizeof(FunctionEntry));
+    char *constantOut = file.data() + header.constantOffset;
+    for (auto& constant: code.constants) {
+        memcpy(constantOut + offsetof(Constant, type), &constant.type, sizeof(constant.type));
+        memcpy(constantOut + offsetof(Constant, intVal), &constant.intVal, sizeof(constant.intVal));
+        constantOut += sizeof(Constant);
+    }
+    memcpy(file.data() + header.stringOffset, strings.data(), strings.size());
+    out.write(file.data(), file.size());
+}
+
+bool ir::isBinaryIr(string_view data) {
+    return data.size() >= sizeof(MAGIC) && memcmp(data.data(), MAGIC, sizeof(MAGIC)) == 0;
+}
+
+
+MappedIr::MappedIr(const string& path) {
+#ifdef SPLC_HAS_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw runtime_error("cannot open " + path);
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        length = info.st_size;
+        void *area = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (area != MAP_FAILED) {
+            base = static_cast<const char*>(area);
+            mapped = true;
+        }
+    }
+    close(fd);
+#endif
+    if (base == nullptr) {
+        FILE *file = fopen(path.c_str(), "rb");
+        if (file == nullptr) throw runtime_error("cannot open " + path);
+        string contents;
+        char chunk[1 << 16];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) contents.append(chunk, n);
+        fclose(file);
+        length = contents.size();
+        copy.reset(new uint64_t[length / sizeof(uint64_t) + 1]);
+        memcpy(copy.get(), contents.data(), length);
+        base = reinterpret_cast<const char*>(copy.get());
+    }
+    try {
+        validate();
+    } catch (const runtime_error& e) {
+#ifdef SPLC_HAS_MMAP
+        if (mapped) munmap(const_cast<char*>(base), length);
+#endif
+        throw runtime_error(path + ": " + e.what());
+    }
+}
+
+MappedIr::~MappedIr() {
+#ifdef SPLC_HAS_MMAP
+    if (mapped) munmap(const_cast<char*>(base), length);
+#endif
+}
+
+void MappedIr::validate() const {
+    if (length < sizeof(Header) || !isBinaryIr(string_view(base, length))) {
+        throw runtime_error("not a binary IR file");
+    }
+    auto& h = header();
+    if (h.version != VERSION) throw runtime_error("unsupported version " + to_string(h.version));
+    if (h.byteOrder != ENDIAN_MARK) throw runtime_error("written on a host of another byte order");
+    auto checkSection = [&](uint32_t offset, size_t size) {
+        if (offset % 8 != 0 || offset > length || size > length - offset) {
+            throw runtime_error("truncated or overlapping sections");
+        }
+    };
+    checkSection(h.tacOffset, size_t(h.tacCount) * sizeof(Tac));
+    checkSection(h.functionOffset, size_t(h.functionCount) * sizeof(FunctionEntry));
+    checkSection(h.constantOffset, size_t(h.constantCount) * sizeof(Constant));
+    checkSection(h.stringOffset, h.stringSize);
+    if (h.stringSize > 0 && base[h.stringOffset + h.stringSize - 1] != '\0') {
+        throw runtime_error("unterminated string table");
+    }
+
+    for (size_t i = 0; i < h.constantCount; ++i) {
+        if (constantOf(Operand::constant(i)).type > Constant::Type::FLOAT) throw runtime_error("invalid constant");
+    }
+    for (auto& tac: *this) {
+        if (tac.op > Opcode::WRITE) throw runtime_error("invalid opcode");
+        for (auto operand: { tac.result, tac.arg1, tac.arg2 }) {
+            switch (operand.kind()) {
+            case Operand::Kind::NONE:
+            case Operand::Kind::TEMP:
+            case Operand::Kind::VARIABLE:
+            case Operand::Kind::LABEL:
+                break;
+            case Operand::Kind::CONSTANT:
+                if (operand.value() >= h.constantCount) throw runtime_error("constant out of range");
+                break;
+            case Operand::Kind::FUNCTION:
+                if (operand.value() >= h.stringSize) throw runtime_error("name out of range");
+                break;
+            default:
+                throw runtime_error("invalid operand");
+            }
+        }
+    }
+    for (size_t i = 0; i < h.functionCount; ++i) {
+        auto& function = functions()[i];
+        if (function.name >= h.stringSize || function.first > h.tacCount || function.count > h.tacCount - function.first) {
+            throw runtime_error("invalid function table");
+        }
+    }
+}
+
+Code MappedIr::toCode() const {
+    Code code;
+    code.tacs.reserve(size());
+    vector<Operand> constants;
+    for (size_t i = 0; i < constantCount(); ++i) {
+        constants.push_back(code.constant(constantOf(Operand::constant(i))));
+    }
+    for (auto tac: *this) {
+        for (Operand *operand: { &tac.result, &tac.arg1, &tac.arg2 }) {
+            if (operand->kind() == Operand::Kind::CONSTANT) {
+                *operand = constants[operand->value()];
+            } else if (operand->kind() == Operand::Kind::FUNCTION) {
+                *operand = Operand::function(Ident(nameOf(*operand)));
+            }
+        }
+        code.tacs.push_back(tac);
+    }
+    return code;
+}
@@ -0,0 +1,131 @@
+#ifndef IR_BINARY_HPP
+#define IR_BINARY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include "tac.hpp"
+
+
+namespace ir {
+
+/**
+ * Binary form of IR, laid out so that a mapped file can be used in place:
+ *
+ *      header
+ *      instructions    ir::Tac[tacCount], where function operands are offsets into the string table
+ *      functions       FunctionEntry[functionCount], in order of definition
+ *      constants       ir::Constant[constantCount]
+ *      strings         NUL-terminated names
+ *
+ * Sections are aligned to 8 bytes, and numbers are in the byte order of the host that wrote the file,
+ * which the loader checks against its own.
+ */
+namespace binary {
+
+constexpr char MAGIC[4] = { 'S', 'P', 'I', 'R' };
+constexpr uint16_t VERSION = 1;
+constexpr uint16_t ENDIAN_MARK = 0x0102;
+
+struct Header {
+    char magic[4];
+    uint16_t version;
+    uint16_t byteOrder;
+    uint32_t tacCount, functionCount, constantCount, stringSize;
+    uint32_t tacOffset, functionOffset, constantOffset, stringOffset;
+};
+
+struct FunctionEntry {
+    uint32_t name;      // offset into the string table
+    uint32_t first;     // index of its FUNCTION instruction
+    uint32_t count;     // of its instructions, including FUNCTION
+};
+
+static_assert(sizeof(Header) == 40, "unexpected padding in the header");
+static_assert(sizeof(Tac) == 16 && offsetof(Tac, result) == 4, "unexpected layout of instructions");
+static_assert(sizeof(Constant) == 8, "unexpected layout of constants");
+
+} // namespace binary
+
+
+void writeBinaryIr(std::ostream& out, const Code& code);
+
+// whether the data begins like a binary IR file
+bool isBinaryIr(std::string_view data);
+
+
+/**
+ * Binary IR file mapped into memory (or read, where mmap is not available).
+ * The layout is validated when it is opened, and a std::runtime_error is thrown if it is broken;
+ * afterwards the instructions are used as they are in the file.
+ */
+class MappedIr {
+private:
+    const char *base = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    std::unique_ptr<uint64_t[]> copy;   // contents of the file, if it could not be mapped
+
+    const binary::Header& header() const {
+        return *reinterpret_cast<const binary::Header*>(base);
+    }
+
+    void validate() const;
+
+public:
+    explicit MappedIr(const std::string& path);
+    MappedIr(const MappedIr&) = delete;
+    MappedIr& operator=(const MappedIr&) = delete;
+    ~MappedIr();
+
+    const Tac *begin() const {
+        return reinterpret_cast<const Tac*>(base + header().tacOffset);
+    }
+
+    const Tac *end() const {
+        return begin() + size();
+    }
+
+    size_t size() const {
+        return header().tacCount;
+    }
+
+    const Tac& operator[](size_t i) const {
+        return begin()[i];
+    }
+
+    const binary::FunctionEntry *functions() const {
+        return reinterpret_cast<const binary::FunctionEntry*>(base + header().functionOffset);
+    }
+
+    size_t functionCount() const {
+        return header().functionCount;
+    }
+
+    const Constant& constantOf(Operand operand) const {
+        return reinterpret_cast<const Constant*>(base + header().constantOffset)[operand.value()];
+    }
+
+    size_t constantCount() const {
+        return header().constantCount;
+    }
+
+    // name of a function operand, or at an offset of the string table
+    std::string_view nameOf(Operand operand) const {
+        return nameAt(operand.value());
+    }
+
+    std::string_view nameAt(uint32_t offset) const {
+        return base + header().stringOffset + offset;
+    }
+
+    // in-memory form, e.g. to be printed as text
+    Code toCode() const;
+};
+
+} // namespace ir
+
+#endif // IR_BINARY_HPP
@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ir_reader.hpp"
+
+using namespace ir;
+using namespace std;
+
+
+namespace {
+
+// temporaries holding addresses taken in operands, renumbered after all other places once the code is read
+const uint32_t FRESH_BASE = 1u << 28;
+
+class LineReader {
+private:
+    Code& code;
+    uint32_t& freshNum;
+    size_t lineNo;
+    vector<string_view> tokens;
+
+    [[noreturn]] void fail(const string& reason) const {
+        throw runtime_error("line " + to_string(lineNo) + ": " + reason);
+    }
+
+    uint32_t number(string_view digits) const {
+        uint32_t value;
+        auto result = from_chars(digits.data(), digits.data() + digits.size(), value);
+        if (digits.empty() || result.ec != errc() || result.ptr != digits.data() + digits.size()) {
+            fail("invalid number " + string(digits));
+        }
+        return value;
+    }
+
+    // temporaries are named tN, and variables vN as by other compilers
+    Operand place(string_view token) const {
+        if (token.size() < 2 || (token[0] != 't' && token[0] != 'v')) fail("expected a place instead of " + string(token));
+        uint32_t id = number(token.substr(1));
+        if (id >= FRESH_BASE) fail("place number too large");
+        return token[0] == 't' ? Operand::temp(id) : Operand::variable(id);
+    }
+
+    Operand label(string_view token) const {
+        static const string_view prefix = "label";
+        if (token.substr(0, prefix.size()) != prefix) fail("expected a label instead of " + string(token));
+        return Operand::label(number(token.substr(prefix.size())));
+    }
+
+    // a place, a constant, or the address of a place
+    Operand value(string_view token) {
+        if (!token.empty() && token[0] == '&') {
+            Operand address = Operand::temp(FRESH_BASE + freshNum++);
+            emit(Opcode::ADDR, address, place(token.substr(1)));
+            return address;
+        }
+        if (token.empty() || token[0] != '#') return place(token);
+        string literal(token.substr(1));
+        char *end;
+        if (literal.find('.') != string::npos) {
+            float floatVal = strtof(literal.c_str(), &end);
+            if (literal.empty() || *end != '\0') fail("invalid constant " + string(token));
+            return code.constant(Constant::ofFloat(floatVal));
+        }
+        long intVal = strtol(literal.c_str(), &end, 10);
+        if (literal.empty() || *end != '\0') fail("invalid constant " + string(token));
+        return code.constant(Constant::ofInt(intVal));
+    }
+
+    void expect(size_t count) const {
+        if (tokens.size() != count) fail("expected " + to_string(count) + " words");
+    }
+
+    void emit(Opcode op, Operand result, Operand arg1 = {}, Operand arg2 = {}) {
+        code.tacs.push_back({ op, result, arg1, arg2 });
+    }
+
+public:
+    LineReader(Code& code, uint32_t& freshNum, size_t lineNo, string_view line):
+        code(code), freshNum(freshNum), lineNo(lineNo) {
+        size_t pos = 0;
+        while (true) {
+            pos = line.find_first_not_of(" \t\r", pos);
+            if (pos == string_view::npos) break;
+            size_t end = line.find_first_of(" \t\r", pos);
+            tokens.push_back(line.substr(pos, end - pos));
+            if (end == string_view::npos) break;
+            pos = end;
+        }
+    }
+
+    void read() {
+        if (tokens.empty()) return;
+        string_view head = tokens[0];
+        if (head == "LABEL" || head == "FUNCTION") {
+            expect(3);
+            if (tokens[2] != ":") fail("expected ':'");
+            if (head == "LABEL") emit(Opcode::LABEL, label(tokens[1]));
+            else emit(Opcode::FUNCTION, Operand::function(Ident(tokens[1])));
+        } else if (head == "GOTO") {
+            expect(2);
+            emit(Opcode::GOTO, label(tokens[1]));
+        } else if (head == "IF") {
+            static const pair<string_view, Opcode> relops[] = {
+                { "<", Opcode::IF_LT }, { "<=", Opcode::IF_LE }, { ">", Opcode::IF_GT },
+                { ">=", Opcode::IF_GE }, { "!=", Opcode::IF_NE }, { "==", Opcode::IF_EQ },
+            };
+            expect(6);
+            if (tokens[4] != "GOTO") fail("expected GOTO");
+            for (auto& relop: relops) {
+                if (relop.first == tokens[2]) {
+                    Operand left = value(tokens[1]);
+                    Operand right = value(tokens[3]);
+                    emit(relop.second, label(tokens[5]), left, right);
+                    return;
+                }
+            }
+            fail("unknown relational operator " + string(tokens[2]));
+        } else if (head == "RETURN" || head == "ARG" || head == "WRITE") {
+            expect(2);
+            emit(head == "RETURN" ? Opcode::RETURN : head == "ARG" ? Opcode::ARG : Opcode::WRITE, {}, value(tokens[1]));
+        } else if (head == "PARAM" || head == "READ") {
+            expect(2);
+            emit(head == "PARAM" ? Opcode::PARAM : Opcode::READ, place(tokens[1]));
+        } else if (head == "DEC") {
+            expect(3);
+            emit(Opcode::DEC, place(tokens[1]), code.constant(Constant::ofInt(number(tokens[2]))));
+        } else if (head[0] == '*') {
+            expect(3);
+            if (tokens[1] != ":=") fail("expected ':='");
+            Operand right = value(tokens[2]);
+            emit(Opcode::DEREF, place(head.substr(1)), right);
+        } else {
+            if (tokens.size() < 3 || tokens[1] != ":=") fail("unknown instruction");
+            Operand result = place(head);
+            if (tokens.size() == 4 && tokens[2] == "CALL") {
+                emit(Opcode::CALL, result, Operand::function(Ident(tokens[3])));
+            } else if (tokens.size() == 5) {
+                static const pair<string_view, Opcode> operators[] = {
+                    { "+", Opcode::ADD }, { "-", Opcode::SUB }, { "*", Opcode::MUL }, { "/", Opcode::DIV },
+                };
+                for (auto& opt: operators) {
+                    if (opt.first == tokens[3]) {
+                        Operand left = value(tokens[2]);
+                        Operand right = value(tokens[4]);
+                        emit(opt.second, result, left, right);
+                        return;
+                    }
+                }
+                fail("unknown operator " + string(tokens[3]));
+            } else {
+                expect(3);
+                string_view right = tokens[2];
+                if (right[0] == '&') {
+                    emit(Opcode::ADDR, result, place(right.substr(1)));
+                } else if (right[0] == '*') {
+                    Operand address = value(right.substr(1));
+                    emit(Opcode::FETCH, result, address);
+                } else {
+                    Operand source = value(right);
+                    emit(Opcode::ASSIGN, result, source);
+                }
+            }
+        }
+    }
+};
+
+} // namespace
+
+
+Code ir::readIr(istream& in) {
+    Code code;
+    uint32_t freshNum = 0;
+    string line;
+    for (size_t lineNo = 1; getline(in, line); ++lineNo) {
+        LineReader(code, freshNum, lineNo, line).read();
+    }
+
+    // splc numbers temporaries and variables from one sequence, so variables are numbered after temporaries
+    uint32_t tempNum = 0, variableNum = 0;
+    for (auto& tac: code.tacs) {
+        for (auto operand: { tac.result, tac.arg1, tac.arg2 }) {
+            if (operand.kind() == Operand::Kind::TEMP && operand.value() < FRESH_BASE) {
+                tempNum = max(tempNum, operand.value());
+            } else if (operand.kind() == Operand::Kind::VARIABLE) {
+                variableNum = max(variableNum, operand.value());
+            }
+        }
+    }
+    for (auto& tac: code.tacs) {
+        for (Operand *operand: { &tac.result, &tac.arg1, &tac.arg2 }) {
+            if (operand->kind() == Operand::Kind::VARIABLE) {
+                *operand = operand->withValue(operand->value() + tempNum);
+            } else if (operand->kind() == Operand::Kind::TEMP && operand->value() >= FRESH_BASE) {
+                *operand = operand->withValue(operand->value() - FRESH_BASE + 1 + tempNum + variableNum);
+            }
+        }
+    }
+    return code;
+}
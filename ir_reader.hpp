@@ -0,0 +1,20 @@
+#ifndef IR_READER_HPP
+#define IR_READER_HPP
+
+#include <istream>
+#include "tac.hpp"
+
+
+namespace ir {
+
+/**
+ * Parses the text form of IR, as written by ir::IrWriter, or by compilers that name variables vN
+ * and pass addresses as `ARG &v'. Places named tN are read as temporaries, which splc does not tell
+ * from variables in text, and variables are renumbered after them.
+ * Throws std::runtime_error with the line number on malformed input.
+ */
+Code readIr(std::istream& in);
+
+} // namespace ir
+
+#endif // IR_READER_HPP
@@ -0,0 +1,153 @@
+#include <charconv>
+#include <cstdio>
+#include <stdexcept>
+#include "ir_writer.hpp"
+
+using namespace ir;
+using namespace std;
+
+
+void IrWriter::put(string_view str) {
+    if (used + str.size() > CAPACITY) {
+        flush();
+        if (str.size() > CAPACITY) {
+            out.write(str.data(), str.size());
+            return;
+        }
+    }
+    str.copy(buffer.get() + used, str.size());
+    used += str.size();
+}
+
+void IrWriter::putNumber(long long value) {
+    char digits[24];
+    auto end = to_chars(digits, digits + sizeof(digits), value).ptr;
+    put(string_view(digits, end - digits));
+}
+
+void IrWriter::putOperand(const Code& code, Operand operand) {
+    switch (operand.kind()) {
+    case Operand::Kind::TEMP:
+    case Operand::Kind::VARIABLE:
+        put('t');
+        putNumber(operand.value());
+        break;
+    case Operand::Kind::CONSTANT: {
+        auto& constant = code.constantOf(operand);
+        put('#');
+        if (constant.type == Constant::Type::FLOAT) {
+            char text[64];  // as formatted by std::to_string
+            int length = snprintf(text, sizeof(text), "%f", constant.floatVal);
+            put(string_view(text, length));
+        } else {
+            putNumber(constant.intVal);
+        }
+    } break;
+    case Operand::Kind::LABEL:
+        put("label");
+        putNumber(operand.value());
+        break;
+    case Operand::Kind::FUNCTION:
+        put(operand.name().str());
+        break;
+    case Operand::Kind::NONE:
+        throw invalid_argument("missing operand");
+    }
+}
+
+void IrWriter::write(const Code& code, const Tac& tac) {
+    auto arith = [&](const char *opt) {
+        putOperand(code, tac.result);
+        put(" := ");
+        putOperand(code, tac.arg1);
+        put(opt);
+        putOperand(code, tac.arg2);
+    };
+    auto branch = [&](const char *relop) {
+        put("IF ");
+        putOperand(code, tac.arg1);
+        put(relop);
+        putOperand(code, tac.arg2);
+        put(" GOTO ");
+        putOperand(code, tac.result);
+    };
+
+    switch (tac.op) {
+    case Opcode::LABEL:
+        put("LABEL ");
+        putOperand(code, tac.result);
+        put(" :");
+        break;
+    case Opcode::FUNCTION:
+        put("FUNCTION ");
+        putOperand(code, tac.result);
+        put(" :");
+        break;
+    case Opcode::ASSIGN:
+        putOperand(code, tac.result);
+        put(" := ");
+        putOperand(code, tac.arg1);
+        break;
+    case Opcode::ADD: arith(" + "); break;
+    case Opcode::SUB: arith(" - "); break;
+    case Opcode::MUL: arith(" * "); break;
+    case Opcode::DIV: arith(" / "); break;
+    case Opcode::ADDR:
+        putOperand(code, tac.result);
+        put(" := &");
+        putOperand(code, tac.arg1);
+        break;
+    case Opcode::FETCH:
+        putOperand(code, tac.result);
+        put(" := *");
+        putOperand(code, tac.arg1);
+        break;
+    case Opcode::DEREF:
+        put('*');
+        putOperand(code, tac.result);
+        put(" := ");
+        putOperand(code, tac.arg1);
+        break;
+    case Opcode::GOTO:
+        put("GOTO ");
+        putOperand(code, tac.result);
+        break;
+    case Opcode::IF_LT: branch(" < "); break;
+    case Opcode::IF_LE: branch(" <= "); break;
+    case Opcode::IF_GT: branch(" > "); break;
+    case Opcode::IF_GE: branch(" >= "); break;
+    case Opcode::IF_NE: branch(" != "); break;
+    case Opcode::IF_EQ: branch(" == "); break;
+    case Opcode::RETURN:
+        put("RETURN ");
+        putOperand(code, tac.arg1);
+        break;
+    case Opcode::DEC:
+        put("DEC ");
+        putOperand(code, tac.result);
+        put(' ');
+        putNumber(code.constantOf(tac.arg1).intVal);
+        break;
+    case Opcode::PARAM:
+        put("PARAM ");
+        putOperand(code, tac.result);
+        break;
+    case Opcode::ARG:
+        put("ARG ");
+        putOperand(code, tac.arg1);
+        break;
+    case Opcode::CALL:
+        putOperand(code, tac.result);
+        put(" := CALL ");
+        putOperand(code, tac.arg1);
+        break;
+    case Opcode::READ:
+        put("READ ");
+        putOperand(code, tac.result);
+        break;
+    case Opcode::WRITE:
+        put("WRITE ");
+        putOperand(code, tac.arg1);
+        break;
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef IR_WRITER_HPP
+#define IR_WRITER_HPP
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include "tac.hpp"
+
+
+namespace ir {
+
+/**
+ * Formats IR into a large buffer, and hands it to the stream in few large writes.
+ * The text is the same as printed by `operator<<(std::ostream&, const Code&)`.
+ */
+class IrWriter final {
+private:
+    static constexpr size_t CAPACITY = 1 << 16;
+
+    std::ostream& out;
+    std::unique_ptr<char[]> buffer;
+    size_t used = 0;
+
+    void put(char c) {
+        if (used == CAPACITY) flush();
+        buffer[used++] = c;
+    }
+
+    void put(std::string_view str);
+    void putNumber(long long value);
+    void putOperand(const Code& code, Operand operand);
+
+public:
+    explicit IrWriter(std::ostream& out): out(out), buffer(new char[CAPACITY]) {}
+    IrWriter(const IrWriter&) = delete;
+    IrWriter& operator=(const IrWriter&) = delete;
+    ~IrWriter() {
+        flush();
+    }
+
+    void write(const Code& code, const Tac& tac);
+
+    // one instruction per line
+    IrWriter& operator<<(const Code& code) {
+        for (auto& tac: code.tacs) {
+            write(code, tac);
+            put('\n');
+        }
+        return *this;
+    }
+
+    // errors are left in the state of the stream
+    void flush() {
+        if (used > 0) out.write(buffer.get(), used);
+        used = 0;
+    }
+};
+
+} // namespace ir
+
+#endif // IR_WRITER_HPP
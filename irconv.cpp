@@ -0,0 +1,62 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "cfg.hpp"
+#include "ir_binary.hpp"
+#include "ir_reader.hpp"
+#include "ir_writer.hpp"
+
+using namespace std;
+
+
+// converts IR between the text and the binary form, in the direction given by the form of the input,
+// or draws the control-flow graphs of its functions with --dot
+int main(int argc, const char ** argv) {
+    bool dot = argc == 4 && strcmp(argv[1], "--dot") == 0;
+    if (argc != 3 && !dot) {
+        cerr << "Usage:\n\t" << argv[0] << " input.ir output.irb\n"
+            << "\t" << argv[0] << " input.irb output.ir\n"
+            << "\t" << argv[0] << " --dot input.ir|input.irb output.dot" << endl;
+        return 1;
+    }
+    string input = argv[argc - 2], output = argv[argc - 1];
+
+    try {
+        ifstream probe(input, ios::binary);
+        if (!probe) throw runtime_error("cannot open " + input);
+        char magic[sizeof(ir::binary::MAGIC)] = {};
+        probe.read(magic, sizeof(magic));
+        bool binary = ir::isBinaryIr(string_view(magic, probe.gcount()));
+        probe.close();
+
+        ir::Code code;
+        if (binary) {
+            code = ir::MappedIr(input).toCode();
+        } else {
+            ifstream in(input);
+            try {
+                code = ir::readIr(in);
+            } catch (const runtime_error& e) {
+                throw runtime_error(input + ": " + e.what());
+            }
+        }
+
+        ofstream out(output, ios::binary);
+        if (!out) throw runtime_error("cannot open " + output);
+        if (dot) {
+            for (auto& cfg: ir::Cfg::ofFunctions(code)) cfg.printDot(out);
+        } else if (binary) {
+            ir::IrWriter(out) << code;
+        } else {
+            ir::writeBinaryIr(out, code);
+        }
+        out.close();
+        if (!out) throw runtime_error("failed to write " + output);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 2;
+    }
+    return 0;
+}
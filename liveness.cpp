@@ -0,0 +1,52 @@
+#include "liveness.hpp"
+
+using namespace ir;
+using namespace std;
+
+
+Liveness::Liveness(const Cfg& cfg, const vector<bool>& untracked): cfg(cfg) {
+    auto& code = cfg.getCode();
+    size_t first = cfg[0].first, last = cfg[cfg.size() - 1].last;
+    for (size_t i = first; i < last; ++i) {
+        auto& tac = code.tacs[i];
+        for (auto operand: { tac.result, tac.arg1, tac.arg2 }) {
+            if (!operand.isPlace() || untracked[operand.value()]) continue;
+            if (indices.emplace(operand.value(), placeList.size()).second) placeList.push_back(operand);
+        }
+    }
+
+    // places read in each block before being assigned there, and places assigned there
+    vector<vector<bool>> reads(cfg.size(), vector<bool>(placeList.size()));
+    vector<vector<bool>> assigns(cfg.size(), vector<bool>(placeList.size()));
+    for (auto b: cfg.reversePostorder()) {
+        for (size_t i = cfg[b].first; i < cfg[b].last; ++i) {
+            auto& tac = code.tacs[i];
+            forEachUse(tac, [&](Operand operand, bool) {
+                uint32_t index = indexOf(operand);
+                if (index != NO_INDEX && !assigns[b][index]) reads[b][index] = true;
+            });
+            uint32_t result = writesResult(tac.op) ? indexOf(tac.result) : NO_INDEX;
+            if (result != NO_INDEX) assigns[b][result] = true;
+        }
+    }
+
+    // backward over the reverse postorder, so that most successors are done before their predecessors
+    liveIn.assign(cfg.size(), vector<bool>(placeList.size()));
+    liveOut.assign(cfg.size(), vector<bool>(placeList.size()));
+    auto& order = cfg.reversePostorder();
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (auto b = order.rbegin(); b != order.rend(); ++b) {
+            auto& out = liveOut[*b];
+            for (auto succ: cfg[*b].succs) {
+                for (size_t p = 0; p < placeList.size(); ++p) {
+                    if (liveIn[succ][p] && !out[p]) out[p] = changed = true;
+                }
+            }
+            auto& in = liveIn[*b];
+            for (size_t p = 0; p < placeList.size(); ++p) {
+                if (!in[p] && (reads[*b][p] || (out[p] && !assigns[*b][p]))) in[p] = changed = true;
+            }
+        }
+    }
+}
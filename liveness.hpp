@@ -0,0 +1,72 @@
+#ifndef LIVENESS_HPP
+#define LIVENESS_HPP
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "cfg.hpp"
+#include "tac.hpp"
+
+
+namespace ir {
+
+/**
+ * Places of a function that some path from the boundaries of its blocks reads before assigning them.
+ * Only places the function can track (see untrackedPlaces) are considered, as the others may be read
+ * behind calls and stores. Sets are indexed by the order in which places first appear in the function.
+ * Blocks that cannot be reached have nothing live.
+ */
+class Liveness {
+public:
+    static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+private:
+    const Cfg& cfg;
+    std::vector<Operand> placeList;
+    std::unordered_map<uint32_t, uint32_t> indices;     // by the number of each place
+    std::vector<std::vector<bool>> liveIn, liveOut;
+
+public:
+    Liveness(const Cfg& cfg, const std::vector<bool>& untracked);
+
+    const std::vector<Operand>& places() const {
+        return placeList;
+    }
+
+    // the index of a tracked place of the function in the sets, or NO_INDEX
+    uint32_t indexOf(Operand operand) const {
+        if (!operand.isPlace()) return NO_INDEX;
+        auto found = indices.find(operand.value());
+        return found != indices.end() ? found->second : NO_INDEX;
+    }
+
+    const std::vector<bool>& liveAtEntry(uint32_t block) const {
+        return liveIn[block];
+    }
+
+    const std::vector<bool>& liveAtExit(uint32_t block) const {
+        return liveOut[block];
+    }
+
+    // calls visit(index, live) for the instructions of the block from the last one back,
+    // with the places live right after each of them
+    template <typename Visit>
+    void walkBackward(uint32_t block, Visit&& visit) const {
+        auto live = liveOut[block];
+        auto& code = cfg.getCode();
+        for (size_t i = cfg[block].last; i > cfg[block].first; --i) {
+            auto& tac = code.tacs[i - 1];
+            visit(i - 1, static_cast<const std::vector<bool>&>(live));
+            uint32_t result = writesResult(tac.op) ? indexOf(tac.result) : NO_INDEX;
+            if (result != NO_INDEX) live[result] = false;
+            forEachUse(tac, [&](Operand operand, bool) {
+                uint32_t index = indexOf(operand);
+                if (index != NO_INDEX) live[index] = true;
+            });
+        }
+    }
+};
+
+} // namespace ir
+
+#endif // LIVENESS_HPP
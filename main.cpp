@@ -1,11 +1,22 @@
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <memory>
-// #include "ast_dump.hpp"
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "ast_dump.hpp"
 #include "parser.hpp"
 #include "semantic.hpp"
 #include "gen_tac.hpp"
+#include "ir_binary.hpp"
+#include "ir_writer.hpp"
+#include "optimizer.hpp"
+#include "stats.hpp"
+#include "worker_pool.hpp"
 
 using namespace std;
 
@@ -13,62 +24,207 @@ const int CMD_ERR       = 0x1;
 const int IO_ERR        = 0x2;
 const int PARSING_ERR   = 0x4;
 const int SEMANTIC_ERR  = 0x8;
+const int GEN_TAC_ERR   = 0x10;
 
+static mutex errMutex;  // keeps the reports of files compiled concurrently apart
 
-static string targetPathOf(const string& srcPath) {
+
+static string targetPathOf(const string& srcPath, bool binary) {
     static const string suffix = ".spl";
 
-    size_t prefixLen = srcPath.length() - suffix.length();
-    if (prefixLen < 0 || srcPath.compare(prefixLen, suffix.length(), suffix) != 0) {
+    if (srcPath.length() < suffix.length() ||
+        srcPath.compare(srcPath.length() - suffix.length(), suffix.length(), suffix) != 0
+    ) {
         throw invalid_argument("Invalid source file path!");
     }
 
-    return srcPath.substr(0, prefixLen) + ".ir";
+    return srcPath.substr(0, srcPath.length() - suffix.length()) + (binary ? ".irb" : ".ir");
 }
 
+static void reportErr(const string& msg) {
+    lock_guard<mutex> lock(errMutex);
+    cerr << msg << flush;
+}
 
-int main(int argc, const char ** argv) {
-    // check cli arguments
-    if (argc != 2) {
-        cerr << "Usage:\n\t" << argv[0] << " /path/to/source/file.spl" << endl;
-        exit(CMD_ERR);
-    }
+// compiles a single source into an .ir (or a binary .irb) file next to it, and returns its exit status
+// the source "-" is read from stdin, and its IR is written to stdout
+// the code is optimized at `optLevel' (0 for none), inlining functions of up to `inlineLimit' instructions,
+// and phases and their products are recorded into `stats' if it is given
+static int compile(const string& srcPath, unsigned workerNum, bool binary, int optLevel, size_t inlineLimit, Stats *stats) {
+    bool isStdio = srcPath == "-";
 
     // filenames
-    const char * srcPath = argv[1];
-    string targetPath = targetPathOf(srcPath);
+    string targetPath;
+    try {
+        if (!isStdio) targetPath = targetPathOf(srcPath, binary);
+    } catch (const invalid_argument& e) {
+        reportErr(srcPath + ": " + e.what() + '\n');
+        return CMD_ERR;
+    }
 
-    FILE * srcFile;
-    if (!(srcFile = fopen(srcPath, "r"))) {
-        cerr << "Failed to open file(s)" << endl;
-        exit(IO_ERR);
+    FILE * srcFile = stdin;
+    if (!isStdio && !(srcFile = fopen(srcPath.c_str(), "r"))) {
+        reportErr("Failed to open file(s)\n");
+        return IO_ERR;
     }
 
     // parsing
-    unique_ptr<ast::Program> ast(parseFile(srcFile));
-    fclose(srcFile);
-    if (!ast) exit(PARSING_ERR);
+    size_t tokenNum = 0;
+    unique_ptr<ast::Program> ast(stats
+        ? stats->time("parse", [&]() { return parseFile(srcFile, &tokenNum); })
+        : parseFile(srcFile));
+    if (!isStdio) fclose(srcFile);
+    if (stats) stats->count("tokens", tokenNum);
+    if (!ast) return PARSING_ERR;
 
     // // dump ast
     // auto printer = make_unique<ast::Printer>(cout);
     // ast->traverse({ printer.get() });
 
+    if (stats) {
+        auto counter = make_unique<ast::Counter>();
+        ast->traverse({ counter.get() });
+        size_t nodeNum = 0;
+        for (auto& count: counter->counts) nodeNum += count.second;
+        stats->count("nodes", nodeNum);
+        for (auto& count: counter->counts) stats->count("nodes." + count.first, count.second);
+    }
+
     // semantic analysis
-    auto semanticErrs = smt::analyzeSemantic(ast.get());
+    auto semanticErrs = smt::analyzeSemantic(ast.get(), stats);
     if (!semanticErrs.empty()) {
+        ostringstream errs;
         for (auto& semanticErr: semanticErrs) {
-            cerr << semanticErr << std::endl;
+            errs << semanticErr << std::endl;
         }
-        exit(SEMANTIC_ERR);
+        reportErr(errs.str());
+        return SEMANTIC_ERR;
     }
 
     // intermediate code generation
-    auto tacGenerator = make_unique<ir::TacGenerator>(ast.get());
-    ofstream fout(targetPath);
-    for (auto tacPtr: tacGenerator->getTac()) {
-        fout << *tacPtr << std::endl;
+    unique_ptr<ir::TacGenerator> tacGenerator;
+    try {
+        auto generate = [&]() { return make_unique<ir::TacGenerator>(ast.get(), workerNum); };
+        tacGenerator = stats ? stats->time("gen_tac", generate) : generate();
+    } catch (const exception& e) {
+        reportErr(srcPath + ": failed to generate intermediate code: " + e.what() + '\n');
+        return GEN_TAC_ERR;
+    }
+    if (stats) {
+        stats->count("tac", tacGenerator->getTac().size());
+        stats->count("temporaries", tacGenerator->tempCount());
+        stats->count("variables", tacGenerator->variableCount());
+        stats->count("labels", tacGenerator->labelCount());
+    }
+
+    // optimization
+    if (optLevel > 0) {
+        auto optimize = [&]() { ir::optimize(tacGenerator->getTac(), optLevel, inlineLimit); };
+        if (stats) stats->time("optimize", optimize); else optimize();
+        if (stats) {
+            stats->count("tac.optimized", tacGenerator->getTac().size());
+            stats->count("temporaries.optimized", ir::temporaryCount(tacGenerator->getTac()));
+        }
+    }
+
+    // output
+    if (isStdio) {
+        auto emit = [&]() {
+            if (binary) ir::writeBinaryIr(cout, tacGenerator->getTac());
+            else ir::IrWriter(cout) << tacGenerator->getTac();
+            cout.flush();
+        };
+        if (stats) stats->time("emit", emit); else emit();
+        return cout ? 0 : IO_ERR;
+    }
+    ofstream fout(targetPath, binary ? ios::binary : ios::out);
+    auto emit = [&]() {
+        if (binary) ir::writeBinaryIr(fout, tacGenerator->getTac());
+        else ir::IrWriter(fout) << tacGenerator->getTac();
+        fout.close();
+    };
+    if (stats) stats->time("emit", emit); else emit();
+    if (!fout) {
+        reportErr("Failed to write " + targetPath + '\n');
+        return IO_ERR;
     }
-    fout.close();
 
     return 0;
 }
+
+static void usage(const char * program) {
+    cerr << "Usage:\n\t" << program << " [-j N] [-O0|-O1|-O2] [--inline=N] [--stats[=json]] [--binary] /path/to/source/file.spl...\n"
+        << "\t" << program << " [-j N] [-O0|-O1|-O2] [--inline=N] [--stats[=json]] [--binary] - < source.spl > target.ir\n"
+        << "\t--inline=N inlines functions of up to N instructions with -O2 (" << ir::DEFAULT_INLINE_LIMIT << " by default, 0 for none)" << endl;
+    exit(CMD_ERR);
+}
+
+enum class StatsFormat { NONE, TEXT, JSON };
+
+// statistics are written to stderr, one report (or one line of JSON) per source
+static int compileWithStats(
+    const string& srcPath, unsigned workerNum, bool binary, int optLevel, size_t inlineLimit, StatsFormat format
+) {
+    if (format == StatsFormat::NONE) return compile(srcPath, workerNum, binary, optLevel, inlineLimit, nullptr);
+    Stats stats(srcPath);
+    int status = compile(srcPath, workerNum, binary, optLevel, inlineLimit, &stats);
+    ostringstream report;
+    if (format == StatsFormat::JSON) stats.printJson(report); else stats.print(report);
+    reportErr(report.str());
+    return status;
+}
+
+
+int main(int argc, const char ** argv) {
+    // check cli arguments
+    unsigned workerNum = defaultWorkerNum();
+    StatsFormat statsFormat = StatsFormat::NONE;
+    bool binary = false;
+    int optLevel = 0;
+    size_t inlineLimit = ir::DEFAULT_INLINE_LIMIT;
+    vector<string> srcPaths;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--stats") == 0) {
+            statsFormat = StatsFormat::TEXT;
+        } else if (strcmp(argv[i], "--stats=json") == 0) {
+            statsFormat = StatsFormat::JSON;
+        } else if (strcmp(argv[i], "--binary") == 0) {
+            binary = true;
+        } else if (strncmp(argv[i], "-O", 2) == 0) {
+            if (argv[i][2] < '0' || argv[i][2] > '2' || argv[i][3] != '\0') usage(argv[0]);
+            optLevel = argv[i][2] - '0';
+        } else if (strncmp(argv[i], "--inline=", 9) == 0) {
+            const char * num = argv[i] + 9;
+            char * end;
+            long n = strtol(num, &end, 10);
+            if (*num == '\0' || *end != '\0' || n < 0) usage(argv[0]);
+            inlineLimit = n;
+        } else if (strncmp(argv[i], "--", 2) == 0) {
+            usage(argv[0]);
+        } else if (strncmp(argv[i], "-j", 2) == 0) {
+            const char * num = argv[i][2] != '\0' ? argv[i] + 2 : (i + 1 < argc ? argv[++i] : "");
+            char * end;
+            long n = strtol(num, &end, 10);
+            if (*num == '\0' || *end != '\0' || n <= 0) usage(argv[0]);
+            workerNum = n;
+        } else {
+            srcPaths.emplace_back(argv[i]);
+        }
+    }
+    if (srcPaths.empty()) usage(argv[0]);
+
+    // a single file is split by functions instead
+    if (srcPaths.size() == 1) return compileWithStats(srcPaths[0], workerNum, binary, optLevel, inlineLimit, statsFormat);
+
+    // batch mode: the exit status combines the status bits of all files
+    vector<int> status(srcPaths.size());
+    parallelFor(srcPaths.size(), workerNum, [&](size_t i) {
+        status[i] = compileWithStats(srcPaths[i], 1, binary, optLevel, inlineLimit, statsFormat);
+    });
+    int result = 0;
+    for (size_t i = 0; i < srcPaths.size(); ++i) {
+        if (status[i] != 0) cerr << srcPaths[i] << ": exit status " << status[i] << endl;
+        result |= status[i];
+    }
+    return result;
+}
@@ -0,0 +1,71 @@
+#ifndef MAPPED_SOURCE_HPP
+#define MAPPED_SOURCE_HPP
+
+#include <cstddef>
+#include <cstdio>
+
+#if __has_include(<sys/mman.h>)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SPLC_HAS_MMAP 1
+#endif
+
+/**
+ * Source file mapped into memory and followed by two NUL bytes, the sentinels that yy_scan_buffer expects,
+ * so that the scanner can work on the file in place instead of copying it through stdio and its own buffers.
+ * The mapping is private: the scanner writes into it, but the file never changes.
+ * It is empty (and the caller should fall back to reading the stream) for pipes, terminals, empty files,
+ * streams that have already been read from, or on platforms without mmap.
+ */
+class MappedSource {
+private:
+    char *base = nullptr;
+    size_t length = 0;      // of the file
+    size_t reserved = 0;    // of the whole mapping, including the sentinels
+
+public:
+    explicit MappedSource(FILE *file) {
+#ifdef SPLC_HAS_MMAP
+        struct stat info;
+        int fd = fileno(file);
+        if (fd < 0 || fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size <= 0) return;
+        if (ftell(file) != 0) return;
+        length = info.st_size;
+        reserved = length + 2;
+        // zeroed pages to hold the sentinels when the file ends on a page boundary
+        void *area = mmap(nullptr, reserved, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (area == MAP_FAILED) return;
+        // the kernel fills the rest of the last page of the file with zeros
+        if (mmap(area, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+            munmap(area, reserved);
+            return;
+        }
+        base = static_cast<char*>(area);
+#endif
+    }
+
+    MappedSource(const MappedSource&) = delete;
+    MappedSource& operator=(const MappedSource&) = delete;
+
+    ~MappedSource() {
+#ifdef SPLC_HAS_MMAP
+        if (base != nullptr) munmap(base, reserved);
+#endif
+    }
+
+    bool empty() const {
+        return base == nullptr;
+    }
+
+    char * data() const {
+        return base;
+    }
+
+    // including the two sentinels
+    size_t bufferSize() const {
+        return length + 2;
+    }
+};
+
+#endif // MAPPED_SOURCE_HPP
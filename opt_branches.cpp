@@ -0,0 +1,89 @@
+#include "optimizer.hpp"
+
+using namespace ir;
+using namespace std;
+
+
+namespace {
+
+class BranchSimplifier {
+private:
+    Code& code;
+    vector<size_t> labels;
+
+    // index of the first instruction after the labels from i on
+    size_t skipLabels(size_t i) const {
+        while (i < code.size() && code.tacs[i].op == Opcode::LABEL) ++i;
+        return i;
+    }
+
+    // whether `label' is defined among the labels right before `end'
+    bool labelsBefore(size_t end, Operand label) const {
+        for (size_t i = end; i > 0 && code.tacs[i - 1].op == Opcode::LABEL; --i) {
+            if (code.tacs[i - 1].result == label) return true;
+        }
+        return false;
+    }
+
+    // the label a jump to `label' ends up at, following GOTOs that come right after labels
+    Operand destination(Operand label) const {
+        // a chain of jumps that loops forever is left alone
+        for (size_t hops = 0; hops < labels.size(); ++hops) {
+            if (label.value() >= labels.size() || labels[label.value()] == NO_LABEL) return label;
+            size_t next = skipLabels(labels[label.value()]);
+            if (next >= code.size() || code.tacs[next].op != Opcode::GOTO || code.tacs[next].result == label) {
+                return label;
+            }
+            label = code.tacs[next].result;
+        }
+        return label;
+    }
+
+public:
+    explicit BranchSimplifier(Code& code): code(code), labels(labelPositions(code)) {}
+
+    bool threadJumps() {
+        bool changed = false;
+        for (auto& tac: code.tacs) {
+            if (!isJump(tac.op)) continue;
+            auto target = destination(tac.result);
+            if (target == tac.result) continue;
+            tac.result = target;
+            changed = true;
+        }
+        return changed;
+    }
+
+    // `IF c GOTO l1; GOTO l2; LABEL l1' becomes `IF !c GOTO l2; LABEL l1', so that the true branch falls through,
+    // and jumps to the labels right after them are removed
+    bool removeJumpsToNext(vector<bool>& removed) {
+        bool changed = false;
+        for (size_t i = 0; i < code.size(); ++i) {
+            auto& tac = code.tacs[i];
+            if (!isJump(tac.op)) continue;
+            size_t end = skipLabels(i + 1);
+            if (labelsBefore(end, tac.result)) {
+                removed[i] = changed = true;
+            } else if (isBranch(tac.op) && i + 1 < code.size() && code.tacs[i + 1].op == Opcode::GOTO &&
+                labelsBefore(skipLabels(i + 2), tac.result)
+            ) {
+                tac.op = negateBranch(tac.op);
+                tac.result = code.tacs[i + 1].result;
+                removed[++i] = changed = true;
+            }
+        }
+        return changed;
+    }
+};
+
+} // namespace
+
+
+bool ir::simplifyBranches(Code& code) {
+    BranchSimplifier simplifier(code);
+    bool changed = simplifier.threadJumps();
+    vector<bool> removed(code.size());
+    changed |= simplifier.removeJumpsToNext(removed);
+    removeMarked(code, removed);
+    return changed;
+}
@@ -0,0 +1,156 @@
+#include "cfg.hpp"
+#include "liveness.hpp"
+#include "optimizer.hpp"
+
+using namespace ir;
+using namespace std;
+
+
+namespace {
+
+class ConstantFolder {
+private:
+    Code& code;
+    vector<bool> untracked;
+    PlaceMap<int32_t> everywhere, varying, local;
+    vector<bool> removed;
+
+    bool tracked(Operand operand) const {
+        return operand.isPlace() && !untracked[operand.value()];
+    }
+
+    bool assignedConstant(const Tac& tac, int32_t& value) const {
+        return tac.op == Opcode::ASSIGN && intConstant(code, tac.arg1, value);
+    }
+
+    // places assigned a single constant by all their definitions hold it wherever they are read,
+    // unless some read may come before any definition, where the place is still zero
+    void findInvariants(size_t first, size_t last) {
+        everywhere.clear();
+        varying.clear();
+        bool nonzero = false;
+        for (size_t i = first; i < last; ++i) {
+            auto& tac = code.tacs[i];
+            if (!writesResult(tac.op) || !tracked(tac.result)) continue;
+            uint32_t place = tac.result.value();
+            int32_t value;
+            auto known = everywhere.find(place);
+            if (varying.find(place) || !assignedConstant(tac, value) || (known && *known != value)) {
+                varying.set(place, 0);
+                everywhere.forget(place);
+            } else {
+                everywhere.set(place, value);
+                nonzero = nonzero || value != 0;
+            }
+        }
+        if (!nonzero) return;
+
+        Cfg cfg(code, first, last);
+        Liveness liveness(cfg, untracked);
+        auto& live = liveness.liveAtEntry(0);
+        for (size_t p = 0; p < live.size(); ++p) {
+            uint32_t place = liveness.places()[p].value();
+            auto known = everywhere.find(place);
+            if (live[p] && known && *known != 0) everywhere.forget(place);
+        }
+    }
+
+    // arithmetic with a constant that leaves the other operand as it is, or always gives zero, as `x + 0' or `x * 0'
+    bool simplified(const Tac& tac, Operand& value) const {
+        int32_t left = 0, right = 0;
+        bool isLeft = intConstant(code, tac.arg1, left), isRight = intConstant(code, tac.arg2, right);
+        switch (tac.op) {
+        case Opcode::ADD:
+            if (isLeft && left == 0) value = tac.arg2;
+            else if (isRight && right == 0) value = tac.arg1;
+            else return false;
+            return true;
+        case Opcode::SUB:
+        case Opcode::DIV:
+            value = tac.arg1;
+            return isRight && right == (tac.op == Opcode::SUB ? 0 : 1);
+        case Opcode::MUL:
+            if ((isLeft && left == 0) || (isRight && right == 0)) value = code.constant(Constant::ofInt(0));
+            else if (isLeft && left == 1) value = tac.arg2;
+            else if (isRight && right == 1) value = tac.arg1;
+            else return false;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    const int32_t *valueOf(uint32_t place) const {
+        auto known = everywhere.find(place);
+        return known ? known : local.find(place);
+    }
+
+public:
+    explicit ConstantFolder(Code& code):
+        code(code), untracked(untrackedPlaces(code)),
+        everywhere(untracked.size()), varying(untracked.size()), local(untracked.size()),
+        removed(code.size()) {}
+
+    // the other places are only known from their last definition up to the next label
+    bool fold(size_t first, size_t last) {
+        findInvariants(first, last);
+        local.clear();
+        bool changed = false;
+        for (size_t i = first; i < last; ++i) {
+            auto& tac = code.tacs[i];
+            if (tac.op == Opcode::LABEL) {
+                local.clear();
+                continue;
+            }
+
+            forEachUse(tac, [&](Operand& operand, bool isAddress) {
+                if (isAddress || !tracked(operand)) return;
+                auto known = valueOf(operand.value());
+                if (!known) return;
+                operand = code.constant(Constant::ofInt(*known));
+                changed = true;
+            });
+
+            int32_t left, right, value;
+            Operand operand;
+            if (tac.op >= Opcode::ADD && tac.op <= Opcode::DIV &&
+                intConstant(code, tac.arg1, left) && intConstant(code, tac.arg2, right) &&
+                evaluate(tac.op, left, right, value)
+            ) {
+                tac = { Opcode::ASSIGN, tac.result, code.constant(Constant::ofInt(value)), {} };
+                changed = true;
+            } else if (simplified(tac, operand)) {
+                tac = { Opcode::ASSIGN, tac.result, operand, {} };
+                changed = true;
+            } else if (isBranch(tac.op) && intConstant(code, tac.arg1, left) && intConstant(code, tac.arg2, right)) {
+                // a decided branch either always jumps, or never does
+                if (evaluateBranch(tac.op, left, right)) tac = { Opcode::GOTO, tac.result, {}, {} };
+                else removed[i] = true;
+                changed = true;
+            }
+
+            if (writesResult(tac.op) && tracked(tac.result)) {
+                if (assignedConstant(tac, value)) local.set(tac.result.value(), value);
+                else local.forget(tac.result.value());
+            }
+        }
+        return changed;
+    }
+
+    void removeDecided() {
+        removeMarked(code, removed);
+    }
+};
+
+} // namespace
+
+
+bool ir::foldConstants(Code& code) {
+    ConstantFolder folder(code);
+    bool changed = false;
+    for (auto& range: functionRanges(code)) {
+        changed |= folder.fold(range.first, range.second);
+    }
+    folder.removeDecided();
+    return changed;
+}
@@ -0,0 +1,143 @@
+#include "optimizer.hpp"
+
+using namespace ir;
+using namespace std;
+
+
+namespace {
+
+// source of a copy, valid as long as the source is not assigned again
+struct Copy {
+    Operand source;
+    uint32_t version;
+};
+
+class CopyPropagator {
+private:
+    static constexpr size_t MAX_DISTANCE = 16;   // instructions looked ahead for the copy of a result
+
+    Code& code;
+    vector<bool> untracked;
+    PlaceMap<Copy> copies;
+    vector<uint32_t> versions;  // how many times each place has been assigned so far
+    vector<bool> removed;
+
+    bool tracked(Operand operand) const {
+        return operand.isPlace() && !untracked[operand.value()];
+    }
+
+    // places that are not tracked may change behind calls and stores, so they are not taken as sources
+    bool copiable(Operand source) const {
+        return source.kind() == Operand::Kind::CONSTANT || tracked(source);
+    }
+
+    const Copy *copyOf(Operand place) const {
+        if (!tracked(place)) return nullptr;
+        auto copy = copies.find(place.value());
+        if (!copy) return nullptr;
+        if (copy->source.isPlace() && versions[copy->source.value()] != copy->version) return nullptr;
+        return copy;
+    }
+
+public:
+    explicit CopyPropagator(Code& code):
+        code(code), untracked(untrackedPlaces(code)),
+        copies(untracked.size()), versions(untracked.size()), removed(code.size()) {}
+
+    // reads of a copy up to the next label are replaced by its source, as nothing else jumps in between
+    bool propagate(size_t first, size_t last) {
+        copies.clear();
+        bool changed = false;
+        for (size_t i = first; i < last; ++i) {
+            auto& tac = code.tacs[i];
+            if (tac.op == Opcode::LABEL) {
+                copies.clear();
+                continue;
+            }
+
+            forEachUse(tac, [&](Operand& operand, bool isAddress) {
+                auto copy = copyOf(operand);
+                if (!copy || (isAddress && !copy->source.isPlace())) return;
+                operand = copy->source;
+                changed = true;
+            });
+
+            if (writesResult(tac.op) && tracked(tac.result)) {
+                uint32_t place = tac.result.value();
+                ++versions[place];
+                if (tac.op == Opcode::ASSIGN && copiable(tac.arg1) && tac.arg1 != tac.result) {
+                    copies.set(place, { tac.arg1, tac.arg1.isPlace() ? versions[tac.arg1.value()] : 0 });
+                } else {
+                    copies.forget(place);
+                }
+            }
+        }
+        return changed;
+    }
+
+    // position of a copy reading the result of the instruction at `def' later in its block, if the target of
+    // the copy is neither read nor assigned in between, so that the instruction can assign the target instead
+    size_t copyReading(size_t def) {
+        Operand place = code.tacs[def].result;
+        size_t copy = def + 1;
+        for (; copy < code.size() && copy <= def + MAX_DISTANCE; ++copy) {
+            auto& tac = code.tacs[copy];
+            if (tac.op == Opcode::ASSIGN && tac.arg1 == place) break;
+            if (tac.op == Opcode::LABEL || tac.op == Opcode::FUNCTION || isJump(tac.op)) return SIZE_MAX;
+        }
+        if (copy >= code.size() || copy > def + MAX_DISTANCE) return SIZE_MAX;
+        if (copy == def + 1) return copy;
+
+        // assignments to places that are not tracked may be seen by the calls and stores in between
+        Operand target = code.tacs[copy].result;
+        if (!tracked(target)) return SIZE_MAX;
+        for (size_t i = def + 1; i < copy; ++i) {
+            bool touched = writesResult(code.tacs[i].op) && code.tacs[i].result == target;
+            forEachUse(code.tacs[i], [&](Operand& operand, bool) { touched = touched || operand == target; });
+            if (touched) return SIZE_MAX;
+        }
+        return copy;
+    }
+
+    // a place read only by a copy later in the block of its single definition is replaced by the target of the copy,
+    // and copies that are never read are deleted
+    bool coalesce() {
+        auto uses = useCounts(code, untracked.size());
+        vector<uint32_t> defs(untracked.size());
+        for (auto& tac: code.tacs) {
+            if (writesResult(tac.op) && tac.result.isPlace()) ++defs[tac.result.value()];
+        }
+
+        bool changed = false;
+        for (size_t i = 0; i < code.size(); ++i) {
+            auto& tac = code.tacs[i];
+            if (removed[i] || !writesResult(tac.op) || !tracked(tac.result)) continue;
+            uint32_t place = tac.result.value();
+            if (tac.op == Opcode::ASSIGN && uses[place] == 0) {
+                removed[i] = true;
+                changed = true;
+            } else if (defs[place] == 1 && uses[place] == 1) {
+                size_t copy = copyReading(i);
+                if (copy == SIZE_MAX) continue;
+                tac.result = code.tacs[copy].result;
+                removed[copy] = true;
+                changed = true;
+            }
+        }
+        removeMarked(code, removed);
+        return changed;
+    }
+};
+
+} // namespace
+
+
+bool ir::propagateCopies(Code& code) {
+    CopyPropagator propagator(code);
+    bool changed = false;
+    for (auto& range: functionRanges(code)) {
+        changed |= propagator.propagate(range.first, range.second);
+    }
+    changed |= propagator.coalesce();
+    return changed;
+}
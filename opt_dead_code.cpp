@@ -0,0 +1,116 @@
+#include "optimizer.hpp"
+
+using namespace ir;
+using namespace std;
+
+
+namespace {
+
+// removes instructions that cannot be reached from the start of their function
+bool removeUnreachable(Code& code) {
+    auto labels = labelPositions(code);
+    vector<bool> reached(code.size());
+    vector<size_t> pending;
+    for (auto& range: functionRanges(code)) {
+        pending.push_back(range.first);
+        while (!pending.empty()) {
+            size_t i = pending.back();
+            pending.pop_back();
+            // follows the instructions in order from i, up to where control leaves or has already been
+            for (; i < range.second && !reached[i]; ++i) {
+                reached[i] = true;
+                auto& tac = code.tacs[i];
+                if (isJump(tac.op)) {
+                    uint32_t label = tac.result.value();
+                    if (label < labels.size() && labels[label] != NO_LABEL) pending.push_back(labels[label]);
+                }
+                if (tac.op == Opcode::GOTO || tac.op == Opcode::RETURN) break;
+            }
+        }
+    }
+
+    vector<bool> removed(code.size());
+    bool changed = false;
+    for (size_t i = 0; i < code.size(); ++i) {
+        // function definitions are kept even when nothing calls them
+        if (!reached[i] && code.tacs[i].op != Opcode::FUNCTION) removed[i] = changed = true;
+    }
+    removeMarked(code, removed);
+    return changed;
+}
+
+// jumps to adjacent labels are pointed at the first of them, and labels nothing jumps to are removed
+bool removeRedundantLabels(Code& code) {
+    vector<uint32_t> aliases;   // by label number, the first label of its run, or 0
+    for (size_t i = 1; i < code.size(); ++i) {
+        auto& tac = code.tacs[i], & previous = code.tacs[i - 1];
+        if (tac.op != Opcode::LABEL || previous.op != Opcode::LABEL) continue;
+        uint32_t label = tac.result.value(), first = previous.result.value();
+        if (label >= aliases.size()) aliases.resize(label + 1);
+        if (first < aliases.size() && aliases[first] != 0) first = aliases[first];
+        aliases[label] = first;
+    }
+
+    vector<uint32_t> jumps;     // to each label
+    bool changed = false;
+    for (auto& tac: code.tacs) {
+        if (!isJump(tac.op)) continue;
+        uint32_t label = tac.result.value();
+        if (label < aliases.size() && aliases[label] != 0) {
+            label = aliases[label];
+            tac.result = tac.result.withValue(label);
+            changed = true;
+        }
+        if (label >= jumps.size()) jumps.resize(label + 1);
+        ++jumps[label];
+    }
+
+    vector<bool> removed(code.size());
+    for (size_t i = 0; i < code.size(); ++i) {
+        auto& tac = code.tacs[i];
+        if (tac.op != Opcode::LABEL) continue;
+        uint32_t label = tac.result.value();
+        if (label >= jumps.size() || jumps[label] == 0) removed[i] = changed = true;
+    }
+    removeMarked(code, removed);
+    return changed;
+}
+
+// whether the instruction has no effect but on its result, and cannot fail at run time
+bool isPure(const Code& code, const Tac& tac) {
+    int32_t divisor;
+    switch (tac.op) {
+    case Opcode::ASSIGN: case Opcode::ADD: case Opcode::SUB: case Opcode::MUL: case Opcode::ADDR:
+        return true;
+    case Opcode::DIV:
+        return intConstant(code, tac.arg2, divisor) && divisor != 0;
+    default:
+        return false;
+    }
+}
+
+// removes computations of places that are never read
+bool removeDeadAssignments(Code& code) {
+    auto untracked = untrackedPlaces(code);
+    auto uses = useCounts(code, untracked.size());
+    vector<bool> removed(code.size());
+    bool changed = false;
+    for (size_t i = 0; i < code.size(); ++i) {
+        auto& tac = code.tacs[i];
+        if (!writesResult(tac.op) || !tac.result.isPlace()) continue;
+        uint32_t place = tac.result.value();
+        if (!untracked[place] && uses[place] == 0 && isPure(code, tac)) removed[i] = changed = true;
+    }
+    removeMarked(code, removed);
+    return changed;
+}
+
+} // namespace
+
+
+bool ir::eliminateDeadCode(Code& code) {
+    bool changed = removeUnreachable(code);
+    changed |= removeRedundantLabels(code);
+    changed |= removeDeadAssignments(code);
+    return changed;
+}
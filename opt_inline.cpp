@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include "cfg.hpp"
+#include "optimizer.hpp"
+
+using namespace ir;
+using namespace std;
+
+
+namespace {
+
+// a function small and simple enough to be copied into its callers
+struct Callee {
+    vector<Operand> params;         // in the order of PARAM
+    size_t first, last;             // the body after the PARAMs, [first, last)
+    vector<Operand> uninitialized;  // places that may be read before being assigned, which start as zero
+};
+
+class Inliner {
+private:
+    Code& code;
+    size_t limit;
+    uint32_t placeNum = 1, labelNum;
+    unordered_map<uint32_t, Callee> callees;   // by the name of the function
+    unordered_set<uint32_t> inlined;
+
+    // places of the function that some path reads before any assignment, as all places of a new frame are zero
+    vector<Operand> uninitialized(size_t first, size_t last) {
+        Cfg cfg(code, first, last);
+        unordered_map<uint32_t, size_t> indices;
+        vector<Operand> places;
+        for (size_t i = first; i < last; ++i) {
+            auto& tac = code.tacs[i];
+            for (auto operand: { tac.result, tac.arg1, tac.arg2 }) {
+                if (operand.isPlace() && indices.emplace(operand.value(), places.size()).second) places.push_back(operand);
+            }
+        }
+
+        // places assigned on every path to the end of each block
+        vector<vector<bool>> assigned(cfg.size(), vector<bool>(places.size(), true));
+        auto transfer = [&](uint32_t b, vector<bool>& set, auto&& read) {
+            for (size_t i = cfg[b].first; i < cfg[b].last; ++i) {
+                auto& tac = code.tacs[i];
+                forEachUse(tac, [&](Operand operand, bool) {
+                    if (operand.isPlace() && !set[indices[operand.value()]]) read(operand);
+                });
+                if (writesResult(tac.op) && tac.result.isPlace()) set[indices[tac.result.value()]] = true;
+            }
+        };
+        auto entering = [&](uint32_t b) {
+            vector<bool> set(places.size(), b != 0);
+            for (auto pred: cfg[b].preds) {
+                if (!cfg.reachable(pred)) continue;
+                for (size_t p = 0; p < places.size(); ++p) set[p] = set[p] && assigned[pred][p];
+            }
+            return set;
+        };
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (auto b: cfg.reversePostorder()) {
+                auto set = entering(b);
+                transfer(b, set, [](Operand) {});
+                if (set != assigned[b]) {
+                    assigned[b] = move(set);
+                    changed = true;
+                }
+            }
+        }
+
+        vector<Operand> read;
+        vector<bool> found(places.size());
+        for (auto b: cfg.reversePostorder()) {
+            auto set = entering(b);
+            transfer(b, set, [&](Operand operand) {
+                if (!found[indices[operand.value()]]) read.push_back(operand);
+                found[indices[operand.value()]] = true;
+            });
+        }
+        return read;
+    }
+
+    // functions up to the size limit that call no other function, have no arrays or addresses taken,
+    // and cannot fall off their end
+    void findCallees() {
+        callees.clear();
+        for (auto& range: functionRanges(code)) {
+            auto& function = code.tacs[range.first];
+            if (function.result.name() == "main") continue;
+            Callee callee;
+            size_t i = range.first + 1;
+            for (; i < range.second && code.tacs[i].op == Opcode::PARAM; ++i) callee.params.push_back(code.tacs[i].result);
+            callee.first = i;
+            callee.last = range.second;
+            if (callee.last - callee.first > limit || callee.first == callee.last) continue;
+            auto end = code.tacs[callee.last - 1].op;
+            if (end != Opcode::RETURN && end != Opcode::GOTO) continue;
+            bool simple = all_of(code.tacs.begin() + callee.first, code.tacs.begin() + callee.last, [](const Tac& tac) {
+                return tac.op != Opcode::CALL && tac.op != Opcode::PARAM && tac.op != Opcode::DEC && tac.op != Opcode::ADDR;
+            });
+            if (!simple) continue;
+            callee.uninitialized = uninitialized(range.first, range.second);
+            callees.emplace(function.result.value(), move(callee));
+        }
+    }
+
+    // instructions of the body with places and labels of their own, where RETURN assigns `result' and leaves
+    void expand(const Callee& callee, Operand result, vector<Tac>& tacs, unordered_map<uint32_t, Operand>& places) {
+        unordered_map<uint32_t, Operand> labels;
+        auto rename = [&](Operand& operand) {
+            if (operand.isPlace()) {
+                auto inserted = places.emplace(operand.value(), Operand());
+                if (inserted.second) inserted.first->second = operand.withValue(placeNum++);
+                operand = inserted.first->second;
+            } else if (operand.kind() == Operand::Kind::LABEL) {
+                auto inserted = labels.emplace(operand.value(), Operand());
+                if (inserted.second) inserted.first->second = Operand::label(labelNum++);
+                operand = inserted.first->second;
+            }
+        };
+
+        for (auto place: callee.uninitialized) {
+            rename(place);
+            tacs.push_back({ Opcode::ASSIGN, place, code.constant(Constant::ofInt(0)), {} });
+        }
+        Operand end = Operand::label(labelNum++);
+        bool jumped = false;
+        for (size_t i = callee.first; i < callee.last; ++i) {
+            auto tac = code.tacs[i];
+            rename(tac.result);
+            rename(tac.arg1);
+            rename(tac.arg2);
+            if (tac.op != Opcode::RETURN) {
+                tacs.push_back(tac);
+                continue;
+            }
+            tacs.push_back({ Opcode::ASSIGN, result, tac.arg1, {} });
+            if (i + 1 < callee.last) {
+                tacs.push_back({ Opcode::GOTO, end, {}, {} });
+                jumped = true;
+            }
+        }
+        if (jumped) tacs.push_back({ Opcode::LABEL, end, {}, {} });
+    }
+
+    // the ARGs whose values the parameters take, as indices into `tacs', the first parameter's first
+    static bool findArgs(const vector<Tac>& tacs, size_t count, vector<size_t>& args) {
+        args.clear();
+        for (size_t i = tacs.size(); i > 0 && args.size() < count; --i) {
+            auto op = tacs[i - 1].op;
+            if (op == Opcode::ARG) args.push_back(i - 1);
+            else if (op == Opcode::LABEL || op == Opcode::FUNCTION || op == Opcode::CALL || isJump(op)) break;
+        }
+        return args.size() == count;
+    }
+
+    bool inlineRound() {
+        findCallees();
+        if (callees.empty()) return false;
+
+        bool changed = false;
+        vector<Tac> tacs;
+        vector<size_t> args;
+        for (auto& tac: code.tacs) {
+            auto found = tac.op == Opcode::CALL ? callees.find(tac.arg1.value()) : callees.end();
+            if (found == callees.end() || !findArgs(tacs, found->second.params.size(), args)) {
+                tacs.push_back(tac);
+                continue;
+            }
+            auto& callee = found->second;
+            unordered_map<uint32_t, Operand> places;
+            for (size_t j = 0; j < args.size(); ++j) {
+                Operand param = callee.params[j];
+                auto inserted = places.emplace(param.value(), param.withValue(placeNum));
+                if (inserted.second) ++placeNum;
+                auto& arg = tacs[args[j]];
+                arg = { Opcode::ASSIGN, inserted.first->second, arg.arg1, {} };
+            }
+            expand(callee, tac.result, tacs, places);
+            inlined.insert(tac.arg1.value());
+            changed = true;
+        }
+        code.tacs = move(tacs);
+        return changed;
+    }
+
+    // functions inlined everywhere they were called
+    void removeUncalled() {
+        unordered_set<uint32_t> called;
+        for (auto& tac: code.tacs) {
+            if (tac.op == Opcode::CALL) called.insert(tac.arg1.value());
+        }
+        vector<bool> removed(code.size());
+        for (auto& range: functionRanges(code)) {
+            uint32_t name = code.tacs[range.first].result.value();
+            if (!inlined.count(name) || called.count(name)) continue;
+            fill(removed.begin() + range.first, removed.begin() + range.second, true);
+        }
+        removeMarked(code, removed);
+    }
+
+public:
+    Inliner(Code& code, size_t limit): code(code), limit(limit), labelNum(labelPositions(code).size()) {
+        for (auto& tac: code.tacs) {
+            for (auto operand: { tac.result, tac.arg1, tac.arg2 }) {
+                if (operand.isPlace()) placeNum = max(placeNum, operand.value() + 1);
+            }
+        }
+    }
+
+    // callers of inlined functions may be inlined in turn, but recursive functions never are
+    bool inlineAll() {
+        bool changed = false;
+        while (inlineRound()) changed = true;
+        if (changed) removeUncalled();
+        return changed;
+    }
+};
+
+} // namespace
+
+
+bool ir::inlineCalls(Code& code, size_t limit) {
+    return Inliner(code, limit).inlineAll();
+}
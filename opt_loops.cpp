@@ -0,0 +1,412 @@
+#include <algorithm>
+#include <unordered_map>
+#include "cfg.hpp"
+#include "optimizer.hpp"
+
+using namespace ir;
+using namespace std;
+
+
+namespace {
+
+bool inLoop(const Loop& loop, uint32_t block) {
+    return binary_search(loop.blocks.begin(), loop.blocks.end(), block);
+}
+
+// a latch falling through into the header leaves no place for a preheader before it
+bool hasPreheader(const Loop& loop) {
+    return find(loop.latches.begin(), loop.latches.end(), loop.header - 1) == loop.latches.end();
+}
+
+// jumps from outside the loop to its header go to `label' instead, which returns whether there are any
+bool redirectEntries(Code& code, const Cfg& cfg, const Loop& loop, Operand label) {
+    auto& header = cfg[loop.header];
+    Operand headerLabel = code.tacs[header.first].result;
+    bool redirected = false;
+    for (auto pred: header.preds) {
+        if (inLoop(loop, pred)) continue;
+        auto& jump = code.tacs[cfg[pred].last - 1];
+        if (isJump(jump.op) && jump.result == headerLabel) {
+            jump.result = label;
+            redirected = true;
+        }
+    }
+    return redirected;
+}
+
+// changes to the code by index, made all at once so that graphs of it stay valid until then
+class Edits {
+private:
+    vector<vector<Tac>> before, after;
+    vector<bool> removed;
+
+public:
+    explicit Edits(size_t size): before(size), after(size), removed(size) {}
+
+    void insertBefore(size_t index, const Tac& tac) {
+        before[index].push_back(tac);
+    }
+
+    void insertAfter(size_t index, const Tac& tac) {
+        after[index].push_back(tac);
+    }
+
+    void remove(size_t index) {
+        removed[index] = true;
+    }
+
+    bool isRemoved(size_t index) const {
+        return removed[index];
+    }
+
+    bool apply(Code& code) const {
+        bool changed = false;
+        vector<Tac> tacs;
+        for (size_t i = 0; i < code.size(); ++i) {
+            tacs.insert(tacs.end(), before[i].begin(), before[i].end());
+            if (!removed[i]) tacs.push_back(code.tacs[i]);
+            tacs.insert(tacs.end(), after[i].begin(), after[i].end());
+            changed = changed || !before[i].empty() || removed[i] || !after[i].empty();
+        }
+        code.tacs = move(tacs);
+        return changed;
+    }
+};
+
+// the preheader is entered where the header was from outside the loop, and runs `tacs' before it
+void addPreheader(Code& code, const Cfg& cfg, const Loop& loop, Operand label, const vector<Tac>& tacs, Edits& edits) {
+    size_t header = cfg[loop.header].first;
+    if (redirectEntries(code, cfg, loop, label)) edits.insertBefore(header, { Opcode::LABEL, label, {}, {} });
+    for (auto& tac: tacs) edits.insertBefore(header, tac);
+}
+
+
+class InvariantMover {
+private:
+    Code& code;
+    vector<bool> untracked;
+    vector<uint32_t> uses;
+    Edits edits;
+    uint32_t labelNum;
+
+    bool tracked(Operand operand) const {
+        return operand.isPlace() && !untracked[operand.value()];
+    }
+
+    // instructions of a loop that compute the same value on every iteration are hoisted to its preheader
+    void hoist(const Cfg& cfg, const Loop& loop) {
+        if (!hasPreheader(loop)) return;
+
+        vector<uint32_t> exits;         // blocks of the loop that leave it
+        unordered_map<uint32_t, uint32_t> defs;
+        unordered_map<uint32_t, vector<pair<uint32_t, size_t>>> reads;     // blocks and indices
+        unordered_map<uint32_t, uint32_t> loopUses;
+        bool stores = false;            // whether the loop may write memory or places that are not tracked
+        for (auto b: loop.blocks) {
+            for (auto succ: cfg[b].succs) {
+                if (!inLoop(loop, succ)) {
+                    exits.push_back(b);
+                    break;
+                }
+            }
+            for (size_t i = cfg[b].first; i < cfg[b].last; ++i) {
+                auto& tac = code.tacs[i];
+                if (edits.isRemoved(i)) continue;
+                stores = stores || tac.op == Opcode::DEREF || tac.op == Opcode::CALL;
+                if (writesResult(tac.op) && tac.result.isPlace()) ++defs[tac.result.value()];
+                forEachUse(tac, [&](Operand operand, bool) {
+                    if (!operand.isPlace()) return;
+                    reads[operand.value()].emplace_back(b, i);
+                    ++loopUses[operand.value()];
+                });
+            }
+        }
+
+        // a block run whenever the loop is entered, before leaving it
+        auto guaranteed = [&](uint32_t block) {
+            if (exits.empty()) return false;
+            for (auto exit: exits) {
+                if (!cfg.dominates(block, exit)) return false;
+            }
+            return true;
+        };
+        // whether input or output may happen in the block before the instruction at `index'
+        auto observable = [&](uint32_t block, size_t index) {
+            for (size_t i = cfg[block].first; i < index; ++i) {
+                auto op = code.tacs[i].op;
+                if (!edits.isRemoved(i) && (op == Opcode::READ || op == Opcode::WRITE || op == Opcode::CALL)) return true;
+            }
+            return false;
+        };
+        // blocks that no path from the header reaches through input or output, which an instruction failing
+        // before the loop would skip
+        vector<bool> quiet(cfg.size(), true);
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (auto b: loop.blocks) {
+                bool entered = true;
+                if (b != loop.header) {
+                    for (auto pred: cfg[b].preds) {
+                        if (inLoop(loop, pred)) entered = entered && quiet[pred] && !observable(pred, cfg[pred].last);
+                    }
+                }
+                if (quiet[b] && !entered) {
+                    quiet[b] = false;
+                    changed = true;
+                }
+            }
+        }
+        auto invariant = [&](Operand operand) {
+            if (!operand.isPlace()) return true;
+            auto found = defs.find(operand.value());
+            return (found == defs.end() || found->second == 0) && (tracked(operand) || !stores);
+        };
+        auto hoistable = [&](uint32_t block, size_t index) {
+            auto& tac = code.tacs[index];
+            bool traps;
+            int32_t divisor = 0;
+            switch (tac.op) {
+            case Opcode::ADD: case Opcode::SUB: case Opcode::MUL: case Opcode::ADDR:
+                traps = false;
+                break;
+            case Opcode::DIV:
+                traps = !intConstant(code, tac.arg2, divisor) || divisor == 0;
+                break;
+            case Opcode::FETCH:
+                if (stores) return false;
+                traps = true;
+                break;
+            default:
+                return false;
+            }
+            if (!tracked(tac.result) || defs[tac.result.value()] != 1) return false;
+            bool operands = true;
+            forEachUse(tac, [&](Operand operand, bool) { operands = operands && invariant(operand); });
+            if (!operands) return false;
+            if (traps && (!guaranteed(block) || !quiet[block] || observable(block, index))) return false;
+
+            // reads in the loop all come after this assignment, and reads elsewhere only if the loop always runs it
+            uint32_t place = tac.result.value();
+            for (auto& read: reads[place]) {
+                if (read.first == block ? read.second <= index : !cfg.dominates(block, read.first)) return false;
+            }
+            return uses[place] == loopUses[place] || guaranteed(block);
+        };
+
+        // hoisted instructions are invariant for the ones reading them, so they are found until none is left
+        vector<Tac> moved;
+        for (bool found = true; found;) {
+            found = false;
+            for (auto b: loop.blocks) {
+                for (size_t i = cfg[b].first; i < cfg[b].last; ++i) {
+                    if (edits.isRemoved(i) || !hoistable(b, i)) continue;
+                    edits.remove(i);
+                    moved.push_back(code.tacs[i]);
+                    --defs[code.tacs[i].result.value()];
+                    found = true;
+                }
+            }
+        }
+        if (!moved.empty()) addPreheader(code, cfg, loop, Operand::label(labelNum++), moved, edits);
+    }
+
+public:
+    explicit InvariantMover(Code& code):
+        code(code), untracked(untrackedPlaces(code)), uses(useCounts(code, untracked.size())),
+        edits(code.size()), labelNum(labelPositions(code).size()) {}
+
+    bool hoistAll() {
+        for (auto& range: functionRanges(code)) {
+            Cfg cfg(code, range.first, range.second);
+            // enclosing loops come first, and take the instructions invariant in them as well
+            for (auto& loop: cfg.loops()) hoist(cfg, loop);
+        }
+        return edits.apply(code);
+    }
+};
+
+
+// value of `scale * iv + offset' plus or minus the terms, where iv is a basic induction variable
+struct Linear {
+    Operand iv;
+    int32_t scale, offset;
+    vector<pair<Opcode, Operand>> terms;    // ADD or SUB of places invariant in the loop
+};
+
+// a basic induction variable, changed by a constant step once in a loop
+struct Basic {
+    size_t step;        // index of the instruction
+    int32_t increment;
+    uint32_t preheaderReads;
+};
+
+class InductionReducer {
+private:
+    Code& code;
+    vector<bool> untracked;
+    vector<uint32_t> uses;
+    Edits edits;
+    uint32_t labelNum, placeNum;
+    vector<pair<uint32_t, Basic>> outermost;  // basic induction variables of outermost loops with reduced ones
+
+    // places numbered from placeNum on are added by the pass
+    bool tracked(Operand operand) const {
+        return operand.isPlace() && operand.value() < untracked.size() && !untracked[operand.value()];
+    }
+
+    void reduce(const Cfg& cfg, const Loop& loop) {
+        if (!hasPreheader(loop)) return;
+
+        unordered_map<uint32_t, uint32_t> defs;
+        for (auto b: loop.blocks) {
+            for (size_t i = cfg[b].first; i < cfg[b].last; ++i) {
+                auto& tac = code.tacs[i];
+                if (writesResult(tac.op) && tac.result.isPlace()) ++defs[tac.result.value()];
+            }
+        }
+        auto single = [&](const Tac& tac) {
+            return writesResult(tac.op) && tracked(tac.result) && defs[tac.result.value()] == 1;
+        };
+        auto invariant = [&](Operand operand) {
+            return operand.kind() == Operand::Kind::CONSTANT || (tracked(operand) && defs.count(operand.value()) == 0);
+        };
+
+        unordered_map<uint32_t, Basic> basics;
+        for (auto b: loop.blocks) {
+            for (size_t i = cfg[b].first; i < cfg[b].last; ++i) {
+                auto& tac = code.tacs[i];
+                if ((tac.op != Opcode::ADD && tac.op != Opcode::SUB) || !single(tac)) continue;
+                int32_t increment;
+                if (tac.arg1 == tac.result && intConstant(code, tac.arg2, increment)) {
+                    if (tac.op == Opcode::SUB) evaluate(Opcode::SUB, 0, increment, increment);
+                } else if (!(tac.op == Opcode::ADD && tac.arg2 == tac.result && intConstant(code, tac.arg1, increment))) {
+                    continue;
+                }
+                basics[tac.result.value()] = { i, increment, 0 };
+            }
+        }
+        if (basics.empty()) return;
+
+        // derived induction variables, computed from a basic one in the same block before it steps again,
+        // with a multiplication somewhere on the way
+        vector<pair<size_t, Linear>> derived;
+        unordered_map<uint32_t, uint32_t> chained;  // reads of each place by derived variables
+        for (auto b: loop.blocks) {
+            unordered_map<uint32_t, Linear> known;
+            auto linearOf = [&](Operand operand, Linear& value) {
+                if (!operand.isPlace()) return false;
+                if (basics.count(operand.value())) {
+                    value = { operand, 1, 0, {} };
+                    return true;
+                }
+                auto found = known.find(operand.value());
+                if (found == known.end()) return false;
+                value = found->second;
+                return true;
+            };
+            for (size_t i = cfg[b].first; i < cfg[b].last; ++i) {
+                auto& tac = code.tacs[i];
+                if (!single(tac)) continue;
+                if (basics.count(tac.result.value())) {
+                    for (auto it = known.begin(); it != known.end();) {
+                        it = it->second.iv == tac.result ? known.erase(it) : next(it);
+                    }
+                    continue;
+                }
+                Linear value;
+                Operand from;
+                int32_t k;
+                // `x * k' or `k * x', `x + y' or `y + x', and `x - y', with k a constant and y invariant
+                for (int swapped = 0; swapped < 2 && from.kind() == Operand::Kind::NONE; ++swapped) {
+                    Operand x = swapped ? tac.arg2 : tac.arg1, y = swapped ? tac.arg1 : tac.arg2;
+                    if (!linearOf(x, value)) continue;
+                    if (tac.op == Opcode::MUL && intConstant(code, y, k) && value.terms.empty()) {
+                        evaluate(Opcode::MUL, value.scale, k, value.scale);
+                        evaluate(Opcode::MUL, value.offset, k, value.offset);
+                    } else if ((tac.op == Opcode::ADD || (tac.op == Opcode::SUB && !swapped)) && invariant(y)) {
+                        if (intConstant(code, y, k)) evaluate(tac.op, value.offset, k, value.offset);
+                        else value.terms.emplace_back(tac.op, y);
+                    } else {
+                        continue;
+                    }
+                    from = x;
+                }
+                if (from.kind() == Operand::Kind::NONE) continue;
+                known[tac.result.value()] = value;
+                if (value.scale != 0 && value.scale != 1) {
+                    derived.emplace_back(i, value);
+                    ++chained[from.value()];
+                }
+            }
+        }
+
+        // those read only to compute others need not be kept up to date, as they become dead
+        vector<Tac> preheader;
+        for (auto& variable: derived) {
+            auto& tac = code.tacs[variable.first];
+            auto& value = variable.second;
+            if (uses[tac.result.value()] <= chained[tac.result.value()]) continue;
+
+            // the initial value is computed in places assigned once, which the other passes fold more easily
+            auto compute = [&](Opcode op, Operand left, Operand right) {
+                Operand result = Operand::temp(placeNum++);
+                preheader.push_back({ op, result, left, right });
+                return result;
+            };
+            Operand initial = compute(Opcode::MUL, value.iv, code.constant(Constant::ofInt(value.scale)));
+            if (value.offset != 0) initial = compute(Opcode::ADD, initial, code.constant(Constant::ofInt(value.offset)));
+            for (auto& term: value.terms) {
+                initial = compute(term.first, initial, term.second);
+                if (term.second.isPlace()) ++uses[term.second.value()];
+            }
+            Operand place = Operand::temp(placeNum++);
+            preheader.push_back({ Opcode::ASSIGN, place, initial, {} });
+            ++uses[value.iv.value()];
+
+            // the place steps along with the induction variable, and replaces the computation
+            auto& basic = basics[value.iv.value()];
+            ++basic.preheaderReads;
+            int32_t increment;
+            evaluate(Opcode::MUL, value.scale, basic.increment, increment);
+            if (increment != 0) {
+                edits.insertAfter(basic.step, { Opcode::ADD, place, place, code.constant(Constant::ofInt(increment)) });
+            }
+            forEachUse(tac, [&](Operand operand, bool) {
+                if (operand.isPlace()) --uses[operand.value()];
+            });
+            tac = { Opcode::ASSIGN, tac.result, place, {} };
+        }
+        if (preheader.empty()) return;
+        addPreheader(code, cfg, loop, Operand::label(labelNum++), preheader, edits);
+        if (loop.parent == Cfg::NO_LOOP) outermost.insert(outermost.end(), basics.begin(), basics.end());
+    }
+
+public:
+    explicit InductionReducer(Code& code):
+        code(code), untracked(untrackedPlaces(code)), uses(useCounts(code, untracked.size())),
+        edits(code.size()), labelNum(labelPositions(code).size()), placeNum(untracked.size()) {}
+
+    bool reduceAll() {
+        for (auto& range: functionRanges(code)) {
+            Cfg cfg(code, range.first, range.second);
+            for (auto& loop: cfg.loops()) reduce(cfg, loop);
+        }
+        // a basic induction variable read only by its own step, besides the preheader of its loop, is dead,
+        // unless an enclosing loop enters the preheader again
+        for (auto& basic: outermost) {
+            if (uses[basic.first] == 1 + basic.second.preheaderReads) edits.remove(basic.second.step);
+        }
+        return edits.apply(code);
+    }
+};
+
+} // namespace
+
+
+bool ir::moveLoopInvariants(Code& code) {
+    return InvariantMover(code).hoistAll();
+}
+
+bool ir::reduceInductionVariables(Code& code) {
+    return InductionReducer(code).reduceAll();
+}
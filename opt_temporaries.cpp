@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <unordered_map>
+#include "cfg.hpp"
+#include "liveness.hpp"
+#include "optimizer.hpp"
+
+using namespace ir;
+using namespace std;
+
+
+namespace {
+
+class TemporaryRenumberer {
+private:
+    Code& code;
+    vector<bool> untracked;
+    vector<bool> reserved;  // numbers of the places that keep them
+    // numbers are handed out from one sequence over all functions, so that none of them is shared by functions
+    // and the places stay tracked by passes run afterwards
+    uint32_t nextNum = 1;
+
+    // the number after those handed out, skipping the reserved ones
+    uint32_t freshNum() {
+        while (nextNum < reserved.size() && reserved[nextNum]) ++nextNum;
+        return nextNum++;
+    }
+
+    // temporaries interfere if one is assigned while the other is live, unless by a copy of the other,
+    // which leaves them holding the same value
+    static vector<vector<bool>> interference(const Cfg& cfg, const Liveness& liveness, const vector<bool>& renumbered) {
+        auto& code = cfg.getCode();
+        size_t n = liveness.places().size();
+        vector<vector<bool>> edges(n, vector<bool>(n));
+        for (auto b: cfg.reversePostorder()) {
+            liveness.walkBackward(b, [&](size_t i, const vector<bool>& live) {
+                auto& tac = code.tacs[i];
+                uint32_t result = writesResult(tac.op) ? liveness.indexOf(tac.result) : Liveness::NO_INDEX;
+                if (result == Liveness::NO_INDEX || !renumbered[result]) return;
+                uint32_t source = tac.op == Opcode::ASSIGN ? liveness.indexOf(tac.arg1) : Liveness::NO_INDEX;
+                for (uint32_t p = 0; p < n; ++p) {
+                    if (!live[p] || !renumbered[p] || p == result || p == source) continue;
+                    edges[result][p] = edges[p][result] = true;
+                }
+            });
+        }
+        return edges;
+    }
+
+    bool renumber(size_t first, size_t last) {
+        Cfg cfg(code, first, last);
+        Liveness liveness(cfg, untracked);
+        auto& places = liveness.places();
+        vector<bool> renumbered(places.size());
+        for (size_t p = 0; p < places.size(); ++p) renumbered[p] = places[p].kind() == Operand::Kind::TEMP;
+        auto edges = interference(cfg, liveness, renumbered);
+
+        // copies between temporaries, whose ends are given the same color where they can be
+        vector<vector<uint32_t>> related(places.size());
+        for (size_t i = first; i < last; ++i) {
+            auto& tac = code.tacs[i];
+            if (tac.op != Opcode::ASSIGN) continue;
+            uint32_t target = liveness.indexOf(tac.result), source = liveness.indexOf(tac.arg1);
+            if (target == Liveness::NO_INDEX || source == Liveness::NO_INDEX || target == source) continue;
+            if (!renumbered[target] || !renumbered[source]) continue;
+            related[target].push_back(source);
+            related[source].push_back(target);
+        }
+
+        // greedy coloring in the order the temporaries first appear
+        constexpr uint32_t NO_COLOR = UINT32_MAX;
+        vector<uint32_t> colors(places.size(), NO_COLOR);
+        uint32_t colorNum = 0;
+        vector<bool> taken;
+        for (uint32_t p = 0; p < places.size(); ++p) {
+            if (!renumbered[p]) continue;
+            taken.assign(colorNum + 1, false);
+            for (uint32_t q = 0; q < places.size(); ++q) {
+                if (edges[p][q] && colors[q] != NO_COLOR) taken[colors[q]] = true;
+            }
+            uint32_t color = NO_COLOR;
+            for (auto q: related[p]) {
+                if (colors[q] != NO_COLOR && !taken[colors[q]]) {
+                    color = colors[q];
+                    break;
+                }
+            }
+            if (color == NO_COLOR) color = find(taken.begin(), taken.end(), false) - taken.begin();
+            colors[p] = color;
+            colorNum = max(colorNum, color + 1);
+        }
+
+        vector<uint32_t> numbers(colorNum);
+        for (auto& number: numbers) number = freshNum();
+        bool changed = false;
+        for (size_t i = first; i < last; ++i) {
+            auto& tac = code.tacs[i];
+            for (Operand *operand: { &tac.result, &tac.arg1, &tac.arg2 }) {
+                uint32_t index = liveness.indexOf(*operand);
+                if (index == Liveness::NO_INDEX || !renumbered[index]) continue;
+                uint32_t number = numbers[colors[index]];
+                changed |= number != operand->value();
+                *operand = operand->withValue(number);
+            }
+        }
+        return changed;
+    }
+
+public:
+    explicit TemporaryRenumberer(Code& code): code(code), untracked(untrackedPlaces(code)), reserved(untracked.size()) {
+        for (auto& tac: code.tacs) {
+            for (auto operand: { tac.result, tac.arg1, tac.arg2 }) {
+                if (!operand.isPlace()) continue;
+                if (operand.kind() != Operand::Kind::TEMP || untracked[operand.value()]) reserved[operand.value()] = true;
+            }
+        }
+    }
+
+    bool renumberAll() {
+        bool changed = false;
+        for (auto& range: functionRanges(code)) changed |= renumber(range.first, range.second);
+
+        // copies between temporaries given the same number are left with nothing to do
+        vector<bool> removed(code.size());
+        for (size_t i = 0; i < code.size(); ++i) {
+            auto& tac = code.tacs[i];
+            if (tac.op == Opcode::ASSIGN && tac.result == tac.arg1) removed[i] = changed = true;
+        }
+        removeMarked(code, removed);
+        return changed;
+    }
+};
+
+} // namespace
+
+
+bool ir::renumberTemporaries(Code& code) {
+    return TemporaryRenumberer(code).renumberAll();
+}
@@ -0,0 +1,225 @@
+#include <unordered_map>
+#include "optimizer.hpp"
+#include "ssa.hpp"
+
+using namespace ir;
+using namespace std;
+
+
+namespace {
+
+// computation whose result can be reused while its operands keep their values
+struct Expression {
+    Opcode op;
+    Operand left, right;
+
+    bool operator==(const Expression& other) const {
+        return op == other.op && left == other.left && right == other.right;
+    }
+};
+
+struct ExpressionHash {
+    size_t operator()(const Expression& e) const {
+        auto bits = [](Operand operand) {
+            return static_cast<uint64_t>(operand.kind()) << 29 | operand.value();
+        };
+        return hash<uint64_t>()((bits(e.left) * 0x9e3779b97f4a7c15ull ^ bits(e.right)) * 31 + static_cast<int>(e.op));
+    }
+};
+
+bool isComputation(Opcode op) {
+    return (op >= Opcode::ADD && op <= Opcode::DIV) || op == Opcode::ADDR;
+}
+
+// operands of commutative operations are ordered, so that `a * b' and `b * a' are the same expression
+Expression expressionOf(const Tac& tac) {
+    Expression e { tac.op, tac.arg1, tac.arg2 };
+    if ((e.op == Opcode::ADD || e.op == Opcode::MUL) &&
+        (e.left.kind() > e.right.kind() || (e.left.kind() == e.right.kind() && e.left.value() > e.right.value()))
+    ) {
+        swap(e.left, e.right);
+    }
+    return e;
+}
+
+
+// result of an expression, and the versions of the places involved when it was computed
+struct Available {
+    Operand result;
+    uint32_t versions[3];
+};
+
+class LocalNumbering {
+private:
+    Code& code;
+    vector<bool> untracked;
+    vector<uint32_t> versions;  // how many times each place has been assigned so far
+    unordered_map<Expression, Available, ExpressionHash> table;
+    vector<bool> removed;
+
+    bool tracked(Operand operand) const {
+        return operand.isPlace() && !untracked[operand.value()];
+    }
+
+    uint32_t versionOf(Operand operand) const {
+        return operand.isPlace() ? versions[operand.value()] : 0;
+    }
+
+    bool stillAvailable(const Available& available, const Expression& e) const {
+        return available.versions[0] == versionOf(available.result) &&
+            available.versions[1] == versionOf(e.left) && available.versions[2] == versionOf(e.right);
+    }
+
+public:
+    explicit LocalNumbering(Code& code):
+        code(code), untracked(untrackedPlaces(code)), versions(untracked.size()), removed(code.size()) {}
+
+    // computations repeated within a block, with none of their places assigned in between, become copies
+    bool number() {
+        bool changed = false;
+        for (size_t i = 0; i < code.size(); ++i) {
+            auto& tac = code.tacs[i];
+            if (tac.op == Opcode::LABEL || tac.op == Opcode::FUNCTION) {
+                table.clear();
+                continue;
+            }
+            // places that are not tracked may change behind calls and stores
+            auto stable = [&](Operand operand) {
+                return operand.kind() == Operand::Kind::CONSTANT || tracked(operand);
+            };
+            bool reusable = isComputation(tac.op) && tracked(tac.result) &&
+                (tac.op == Opcode::ADDR || (stable(tac.arg1) && stable(tac.arg2)));
+            if (reusable) {
+                auto e = expressionOf(tac);
+                auto found = table.find(e);
+                if (found != table.end() && stillAvailable(found->second, e)) {
+                    if (found->second.result == tac.result) {
+                        removed[i] = true;
+                    } else {
+                        tac = { Opcode::ASSIGN, tac.result, found->second.result, {} };
+                    }
+                    changed = true;
+                }
+            }
+            if (writesResult(tac.op) && tac.result.isPlace()) ++versions[tac.result.value()];
+            if (reusable && tac.op != Opcode::ASSIGN) {
+                auto e = expressionOf(tac);
+                // an expression reading its own result cannot be reused
+                if (e.left != tac.result && e.right != tac.result) {
+                    table[e] = { tac.result, { versionOf(tac.result), versionOf(e.left), versionOf(e.right) } };
+                }
+            }
+        }
+        removeMarked(code, removed);
+        return changed;
+    }
+};
+
+
+// value numbering over the dominator tree of each function in SSA form
+class GlobalNumbering {
+private:
+    SsaForm& ssa;
+    unordered_map<uint32_t, Operand> leaders;   // value each name is known to hold
+    unordered_map<Expression, Operand, ExpressionHash> table;
+
+    Operand leaderOf(Operand operand) const {
+        if (!ssa.isName(operand)) return operand;
+        auto found = leaders.find(operand.value());
+        return found != leaders.end() ? found->second : operand;
+    }
+
+    // names hold the same value wherever they are read, but other places may change behind calls and stores
+    bool stable(Operand operand) const {
+        return operand.kind() == Operand::Kind::CONSTANT || ssa.isName(operand);
+    }
+
+    bool reusable(const Tac& tac) const {
+        return isComputation(tac.op) && ssa.isName(tac.result) &&
+            (tac.op == Opcode::ADDR || (stable(tac.arg1) && stable(tac.arg2)));
+    }
+
+    bool number(SsaFunction& function) {
+        auto& blocks = function.blocks;
+        vector<vector<uint32_t>> children(blocks.size());
+        for (uint32_t b = 1; b < blocks.size(); ++b) children[blocks[b].idom].push_back(b);
+
+        bool changed = false;
+        vector<Expression> scope;                                   // expressions entered, in order
+        vector<pair<uint32_t, size_t>> walk { { 0, SIZE_MAX } };    // blocks, with the size of `scope' before them
+        while (!walk.empty()) {
+            auto& top = walk.back();
+            uint32_t b = top.first;
+            if (top.second != SIZE_MAX) {
+                for (size_t n = scope.size() - top.second; n > 0; --n) {
+                    table.erase(scope.back());
+                    scope.pop_back();
+                }
+                walk.pop_back();
+                continue;
+            }
+            top.second = scope.size();
+
+            auto& block = blocks[b];
+            for (auto& phi: block.phis) {
+                // a phi choosing the same value from every predecessor is that value
+                Operand value = leaderOf(phi.args[0]);
+                bool same = true;
+                for (auto arg: phi.args) same = same && leaderOf(arg) == value && arg != phi.result;
+                if (same) leaders[phi.result.value()] = value;
+            }
+            for (auto& tac: block.tacs) {
+                forEachUse(tac, [&](Operand& operand, bool isAddress) {
+                    Operand leader = leaderOf(operand);
+                    if (leader == operand || (isAddress && !leader.isPlace())) return;
+                    operand = leader;
+                    changed = true;
+                });
+                if (tac.op == Opcode::ASSIGN && ssa.isName(tac.result) && stable(tac.arg1)) {
+                    leaders[tac.result.value()] = leaderOf(tac.arg1);
+                } else if (reusable(tac)) {
+                    auto e = expressionOf(tac);
+                    auto found = table.find(e);
+                    if (found != table.end()) {
+                        leaders[tac.result.value()] = found->second;
+                        tac = { Opcode::ASSIGN, tac.result, found->second, {} };
+                        changed = true;
+                    } else {
+                        table.emplace(e, tac.result);
+                        scope.push_back(e);
+                    }
+                }
+            }
+            for (auto succ: block.succs) {
+                for (auto& phi: blocks[succ].phis) {
+                    for (auto& arg: phi.args) arg = leaderOf(arg);
+                }
+            }
+            for (auto child: children[b]) walk.emplace_back(child, SIZE_MAX);
+        }
+        return changed;
+    }
+
+public:
+    explicit GlobalNumbering(SsaForm& ssa): ssa(ssa) {}
+
+    bool number() {
+        bool changed = false;
+        for (auto& function: ssa.functions) changed |= number(function);
+        return changed;
+    }
+};
+
+} // namespace
+
+
+bool ir::numberValues(Code& code) {
+    return LocalNumbering(code).number();
+}
+
+bool ir::numberValuesGlobally(Code& code) {
+    SsaForm ssa(code);
+    bool changed = GlobalNumbering(ssa).number();
+    ssa.lower();
+    return changed;
+}
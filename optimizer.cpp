@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <unordered_set>
+#include "optimizer.hpp"
+
+using namespace ir;
+using namespace std;
+
+
+vector<pair<size_t, size_t>> ir::functionRanges(const Code& code) {
+    vector<pair<size_t, size_t>> ranges;
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (code.tacs[i].op != Opcode::FUNCTION) continue;
+        if (!ranges.empty()) ranges.back().second = i;
+        ranges.emplace_back(i, code.size());
+    }
+    return ranges;
+}
+
+void ir::removeMarked(Code& code, const vector<bool>& removed) {
+    size_t kept = 0;
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (!removed[i]) code.tacs[kept++] = code.tacs[i];
+    }
+    code.tacs.resize(kept);
+}
+
+vector<bool> ir::untrackedPlaces(const Code& code) {
+    vector<bool> untracked;
+    vector<uint32_t> owners;    // 1 + the index of the function that refers to each place, or 0
+    auto mark = [&](uint32_t place) {
+        if (place >= untracked.size()) untracked.resize(place + 1);
+        untracked[place] = true;
+    };
+    auto ranges = functionRanges(code);
+    for (size_t f = 0; f < ranges.size(); ++f) {
+        for (size_t i = ranges[f].first; i < ranges[f].second; ++i) {
+            auto& tac = code.tacs[i];
+            for (auto operand: { tac.result, tac.arg1, tac.arg2 }) {
+                if (!operand.isPlace()) continue;
+                uint32_t place = operand.value();
+                if (place >= owners.size()) owners.resize(place + 1);
+                if (owners[place] == 0) owners[place] = f + 1;
+                else if (owners[place] != f + 1) mark(place);
+            }
+            if (tac.op == Opcode::DEC) mark(tac.result.value());
+            if (tac.op == Opcode::ADDR && tac.arg1.isPlace()) mark(tac.arg1.value());
+        }
+    }
+    untracked.resize(max(untracked.size(), owners.size()));
+    return untracked;
+}
+
+vector<size_t> ir::labelPositions(const Code& code) {
+    vector<size_t> positions;
+    for (size_t i = 0; i < code.size(); ++i) {
+        auto& tac = code.tacs[i];
+        if (tac.op != Opcode::LABEL) continue;
+        uint32_t label = tac.result.value();
+        if (label >= positions.size()) positions.resize(label + 1, NO_LABEL);
+        positions[label] = i;
+    }
+    return positions;
+}
+
+size_t ir::temporaryCount(const Code& code) {
+    size_t count = 0;
+    for (auto& range: functionRanges(code)) {
+        unordered_set<uint32_t> temps;
+        for (size_t i = range.first; i < range.second; ++i) {
+            auto& tac = code.tacs[i];
+            for (auto operand: { tac.result, tac.arg1, tac.arg2 }) {
+                if (operand.kind() == Operand::Kind::TEMP) temps.insert(operand.value());
+            }
+        }
+        count += temps.size();
+    }
+    return count;
+}
+
+vector<uint32_t> ir::useCounts(const Code& code, size_t placeNum) {
+    vector<uint32_t> counts(placeNum);
+    for (auto& tac: code.tacs) {
+        forEachUse(tac, [&](Operand operand, bool) {
+            if (operand.isPlace()) ++counts[operand.value()];
+        });
+    }
+    return counts;
+}
+
+bool ir::evaluate(Opcode op, int32_t left, int32_t right, int32_t& result) {
+    // as the interpreter does, 32-bit arithmetic wraps around
+    int64_t value;
+    switch (op) {
+    case Opcode::ADD: value = int64_t(left) + right; break;
+    case Opcode::SUB: value = int64_t(left) - right; break;
+    case Opcode::MUL: value = int64_t(left) * right; break;
+    case Opcode::DIV:
+        if (right == 0) return false;
+        value = int64_t(left) / right;
+        break;
+    default:
+        return false;
+    }
+    result = static_cast<int32_t>(static_cast<uint32_t>(value));
+    return true;
+}
+
+bool ir::evaluateBranch(Opcode op, int32_t left, int32_t right) {
+    switch (op) {
+    case Opcode::IF_LT: return left < right;
+    case Opcode::IF_LE: return left <= right;
+    case Opcode::IF_GT: return left > right;
+    case Opcode::IF_GE: return left >= right;
+    case Opcode::IF_NE: return left != right;
+    case Opcode::IF_EQ: return left == right;
+    default: throw invalid_argument("not a conditional branch");
+    }
+}
+
+static void simplify(Code& code) {
+    // each pass may open up chances for the others
+    bool changed;
+    do {
+        changed = foldConstants(code);
+        changed |= numberValues(code);
+        changed |= propagateCopies(code);
+        changed |= simplifyBranches(code);
+        changed |= eliminateDeadCode(code);
+    } while (changed);
+}
+
+void ir::optimize(Code& code, int level, size_t inlineLimit) {
+    if (level <= 0) return;
+    simplify(code);
+    if (level >= 2) {
+        // callees are measured once simplified
+        if (inlineCalls(code, inlineLimit)) simplify(code);
+        // loops are recognized better once the copies left by SSA form are gone
+        numberValuesGlobally(code);
+        simplify(code);
+        moveLoopInvariants(code);
+        reduceInductionVariables(code);
+        simplify(code);
+    }
+    renumberTemporaries(code);
+}
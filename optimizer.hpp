@@ -0,0 +1,102 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "tac.hpp"
+
+
+namespace ir {
+
+// passes over the instructions of each function, which return whether they changed the code
+bool foldConstants(Code& code);
+bool propagateCopies(Code& code);
+bool eliminateDeadCode(Code& code);
+bool simplifyBranches(Code& code);
+bool numberValues(Code& code);
+
+// passes over each function in SSA form or over its loops, which are too costly to run until nothing changes
+bool numberValuesGlobally(Code& code);
+bool moveLoopInvariants(Code& code);
+bool reduceInductionVariables(Code& code);
+
+// copies functions of up to `limit' instructions into their callers, where their calls are replaced
+bool inlineCalls(Code& code, size_t limit);
+
+// gives the temporaries of each function as few numbers as their live ranges allow, by coloring
+// the graph of those live at the same time, and removes the copies between temporaries given the same number
+bool renumberTemporaries(Code& code);
+
+// runs the passes of an optimization level (0 for none), each of 1 until none of them changes the code,
+// before the temporaries are renumbered, with functions of up to `inlineLimit' instructions inlined from level 2 on
+constexpr size_t DEFAULT_INLINE_LIMIT = 16;
+void optimize(Code& code, int level, size_t inlineLimit = DEFAULT_INLINE_LIMIT);
+
+
+// instructions [first, second) of each function, from its FUNCTION on
+std::vector<std::pair<size_t, size_t>> functionRanges(const Code& code);
+
+// removes the instructions marked in `removed', which is indexed like code.tacs
+void removeMarked(Code& code, const std::vector<bool>& removed);
+
+// places that a single function cannot track: shared by several functions, declared by DEC, or whose address is taken
+std::vector<bool> untrackedPlaces(const Code& code);
+
+// index of the LABEL of each label number, or NO_LABEL for those that are not defined
+constexpr size_t NO_LABEL = SIZE_MAX;
+std::vector<size_t> labelPositions(const Code& code);
+
+// how many temporaries each function has, summed over the functions
+size_t temporaryCount(const Code& code);
+
+// how many times each of the first `placeNum' places is read
+std::vector<uint32_t> useCounts(const Code& code, size_t placeNum);
+
+// values of places, forgotten all at once by starting a new generation
+template <typename T>
+class PlaceMap {
+private:
+    std::vector<T> values;
+    std::vector<uint32_t> generations;  // of each value, which is only known in the current one
+    uint32_t generation = 1;
+
+public:
+    explicit PlaceMap(size_t placeNum): values(placeNum), generations(placeNum) {}
+
+    const T *find(uint32_t place) const {
+        return generations[place] == generation ? &values[place] : nullptr;
+    }
+
+    void set(uint32_t place, T value) {
+        values[place] = value;
+        generations[place] = generation;
+    }
+
+    void forget(uint32_t place) {
+        generations[place] = 0;
+    }
+
+    void clear() {
+        ++generation;
+    }
+};
+
+// the value of an integer constant operand, if it is one
+inline bool intConstant(const Code& code, Operand operand, int32_t& value) {
+    if (operand.kind() != Operand::Kind::CONSTANT) return false;
+    auto& constant = code.constantOf(operand);
+    if (constant.type == Constant::Type::FLOAT) return false;
+    value = constant.intVal;
+    return true;
+}
+
+// 32-bit arithmetic as executed, or false if it fails (or is undefined) at run time
+bool evaluate(Opcode op, int32_t left, int32_t right, int32_t& result);
+
+bool evaluateBranch(Opcode op, int32_t left, int32_t right);
+
+} // namespace ir
+
+#endif // OPTIMIZER_HPP
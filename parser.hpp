@@ -3,10 +3,13 @@
 
 // header file for libparser.a
 
+#include <cstddef>
 #include <cstdio>
 #include "ast.hpp"
 
-ast::Program * parseFile(FILE *);
-ast::Program * parseStr(const char *);
+// both are reentrant, so that different sources can be parsed on different threads
+// the number of scanned tokens is stored into `tokenNum' if it is given
+ast::Program * parseFile(FILE *, size_t * tokenNum = nullptr);
+ast::Program * parseStr(const char *, size_t * tokenNum = nullptr);
 
 #endif
@@ -10,49 +10,26 @@ using namespace std;
 // TODO: refactor type resolution for structure and array
 // Consider Future pattern
 
-vector<SemanticErrRecord> smt::analyzeSemantic(Program *ast) {
+vector<SemanticErrRecord> smt::analyzeSemantic(Program *ast, Stats *stats) {
     vector<SemanticErrRecord> semanticErrs;
-    auto scopeSetter = make_unique<ScopeSetter>();
-    auto structInit = make_unique<StructInitializer>(semanticErrs); 
-    auto symbolSetter = make_unique<SymbolSetter>(semanticErrs);
-    auto typeSynthesizer = make_unique<TypeSynthesizer>(semanticErrs);
+    auto structInit = make_unique<StructInitializer>(semanticErrs, ast->types);
+    auto symbolSetter = make_unique<SymbolSetter>(semanticErrs, ast->types, ast->symbols);
+    auto typeSynthesizer = make_unique<TypeSynthesizer>(semanticErrs, ast->symbols);
 
     // order matters!
-    ast->traverse({ scopeSetter.get(), structInit.get() });
-    ast->traverse({ symbolSetter.get(), typeSynthesizer.get() });
-
-    return semanticErrs;
-}
-
-
-void ScopeSetter::defaultEnter(Node *self, Node *parent) {
-    if (self->scope == nullptr) { // scope has not been specified by its parent
-        self->scope = parent->scope;
-    }
-}
-
-void ScopeSetter::enter(Program *self, Node *parent) {
-    self->scope = make_shared<SymbolTable>();
-}
-
-void ScopeSetter::enter(FunDef *self, Node *parent) {
-    self->scope = parent->scope;
-    auto inFuncScope = make_shared<SymbolTable>(self->scope);
-    for (ParamDec * para: self->declarator->parameters) {
-        para->scope = inFuncScope;
+    auto structWalk = [&]() { ast->traverse({ structInit.get() }); };
+    auto symbolWalk = [&]() { ast->traverse({ symbolSetter.get(), typeSynthesizer.get() }); };
+    if (stats != nullptr) {
+        stats->time("semantic.structs", structWalk);
+        stats->time("semantic.symbols", symbolWalk);
+        stats->count("scopes", ast->symbols.scopeCount());
+        stats->count("symbols", ast->symbols.symbolCount());
+    } else {
+        structWalk();
+        symbolWalk();
     }
-    self->body->scope = inFuncScope;
-    // TODO: check whether var definitions in body block are allowed to overwrite function parameters in C language
-}
-
-void ScopeSetter::enter(ForStmt *self, Node *parent) {
-    self->scope = make_shared<SymbolTable>(parent->scope);
-}
 
-void ScopeSetter::enter(CompoundStmt *self, Node *parent) {
-    if (self->scope == nullptr) {
-        self->scope = make_shared<SymbolTable>(parent->scope);
-    }
+    return semanticErrs;
 }
 
 
@@ -71,32 +48,30 @@ bool SemanticAnalyzer::hasErr(Node *node) const {
 
 
 void StructInitializer::enter(StructDef *self, Node *parent) {
-    const string& name = self->specifier->identifier;
+    Ident name = self->specifier->identifier;
     if (this->structures.find(name) != this->structures.end()) {
         this->report(SemanticErr::TYPE15, self, "redefine the same structure type");
     } else {
-        this->structures[name] = self->specifier->type;
+        this->structures[name] = this->types.structure();
     }
 }
 
 void StructInitializer::leave(StructDef *self, Node *parent) {
     if (!this->hasErr(self)) {
-        Shared<Type> type = this->structures[self->specifier->identifier];
-        auto structType = new StructType;
+        // the structure is completed in place, so that all references to it see the fields
+        StructType *structType = this->structures[self->specifier->identifier];
         for (Def *def: self->specifier->definitions) {
-            // Shared<Type> fieldType = def->specifier->type;
             for (Dec *dec: def->declarations) {
-                Shared<Type> fieldType = def->specifier->type;
+                const Type *fieldType = def->specifier->type;
                 auto arrField = dynamic_cast<const ArrDec*>(dec->declarator);  // deduplicate
                 if (arrField != nullptr) {
                     for (auto dim = arrField->dimensions.rbegin(); dim != arrField->dimensions.rend(); ++dim) {
-                        fieldType = makeType<ArrayType>(fieldType, *dim);
+                        fieldType = this->types.array(fieldType, *dim);
                     }
                 }
                 structType->fields.emplace_back(fieldType, dec->declarator->identifier);
             }
         }
-        type.set(structType);
     }
 }
 
@@ -104,6 +79,7 @@ void StructInitializer::enter(StructSpecifier *self, Node *parent) {
     auto typeItr = this->structures.find(self->identifier);
     if (typeItr == this->structures.end()) {
         this->report(SemanticErr::TYPE0, self, "struct undefined");
+        self->type = this->types.structure();   // empty placeholder for later checks
     } else {
         self->type = typeItr->second;
     }
@@ -111,12 +87,11 @@ void StructInitializer::enter(StructSpecifier *self, Node *parent) {
 
 
 void SymbolSetter::enter(Program *self, Node *parent) {
-    auto readType = makeType<FunctionType>(makeType<PrimitiveType>(Primitive::INT));
-    auto writeType = makeType<FunctionType>(makeType<PrimitiveType>(Primitive::INT), vector<Shared<Type>>{
-        makeType<PrimitiveType>(Primitive::INT)
-    });
-    self->scope->setType("read", readType);
-    self->scope->setType("write", writeType);
+    auto intType = TypeContext::primitive(Primitive::INT);
+    auto readType = this->types.function(intType);
+    auto writeType = this->types.function(intType, { intType });
+    this->symbols.declare("read", readType);
+    this->symbols.declare("write", writeType);
 }
 
 void SymbolSetter::enter(ExtVarDef *self, Node *parent) {
@@ -133,23 +108,45 @@ void SymbolSetter::enter(FunDef *self, Node *parent) {
     this->typeRefs[self->declarator->nodeId] = self->specifier->type;
 }
 
+void SymbolSetter::leave(FunDef *self, Node *parent) {
+    this->symbols.popScope();   // opened by its declarator
+}
+
+// the function is declared in the enclosing scope, while its parameters share a new scope with its body
 void SymbolSetter::enter(FunDec *self, Node *parent) {
-    if (self->scope->canOverwrite(self->identifier)) {
-        auto *type = new FunctionType(this->typeRefs[self->nodeId]);
+    if (this->symbols.canOverwrite(self->identifier)) {
+        vector<const Type *> parameters;
         for (ParamDec *para: self->parameters) {
-            Shared<Type> paraType = para->specifier->type;
+            const Type *paraType = para->specifier->type;
             auto arrPara = dynamic_cast<const ArrDec*>(para->declarator);
             if (arrPara != nullptr) {   // TODO: deduplicate
                 for (auto dim = arrPara->dimensions.rbegin(); dim != arrPara->dimensions.rend(); ++dim) {
-                    paraType = makeType<ArrayType>(paraType, *dim);
+                    paraType = this->types.array(paraType, *dim);
                 }
             }
-            type->parameters.push_back(paraType);
+            parameters.push_back(paraType);
         }
-        self->scope->setType(self->identifier, Shared<Type>(type));
+        this->symbols.declare(self->identifier, this->types.function(this->typeRefs[self->nodeId], parameters));
     } else {
-        this->report(SemanticErr::TYPE4, self, "function `" + self->identifier +"' is redefined");
+        this->report(SemanticErr::TYPE4, self, "function `" + self->identifier.str() + "' is redefined");
     }
+    this->symbols.pushScope();
+}
+
+void SymbolSetter::enter(CompoundStmt *self, Node *parent) {
+    if (dynamic_cast<FunDef*>(parent) == nullptr) this->symbols.pushScope();
+}
+
+void SymbolSetter::leave(CompoundStmt *self, Node *parent) {
+    if (dynamic_cast<FunDef*>(parent) == nullptr) this->symbols.popScope();
+}
+
+void SymbolSetter::enter(ForStmt *self, Node *parent) {
+    this->symbols.pushScope();
+}
+
+void SymbolSetter::leave(ForStmt *self, Node *parent) {
+    this->symbols.popScope();
 }
 
 void SymbolSetter::enter(Def *self, Node *parent) {
@@ -163,27 +160,28 @@ void SymbolSetter::enter(Dec *self, Node *parent) {
 }
 
 void SymbolSetter::leave(VarDec *self, Node *parent) {
-    if (!self->scope->canOverwrite(self->identifier)) {
-        this->report(SemanticErr::TYPE3, self, "variable `" + self->identifier + "' is redefined in the same scope");
+    if (!this->symbols.canOverwrite(self->identifier)) {
+        this->report(SemanticErr::TYPE3, self, "variable `" + self->identifier.str() + "' is redefined in the same scope");
     }
-    self->scope->setType(self->identifier, this->typeRefs[self->nodeId]);
+    self->symbol = &this->symbols.declare(self->identifier, this->typeRefs[self->nodeId]);
 }
 
 void SymbolSetter::leave(ArrDec *self, Node *parent) {
-    Shared<Type> type = this->typeRefs[self->nodeId];
+    const Type *type = this->typeRefs[self->nodeId];
     for (auto dim = self->dimensions.rbegin(); dim != self->dimensions.rend(); ++dim) {
-        type = makeType<ArrayType>(type, *dim);
+        type = this->types.array(type, *dim);
     }
-    self->scope->setType(self->identifier, type);
+    self->symbol = &this->symbols.declare(self->identifier, type);
 }
 
 
 void TypeSynthesizer::leave(IdExp *self, Node *parent) {
-    optional<Shared<Type>> defined = self->scope->getType(self->identifier);
-    if (defined) {
-        self->type = defined.value();
+    Symbol *defined = this->symbols.lookup(self->identifier);
+    if (defined != nullptr) {
+        self->symbol = defined;
+        self->type = defined->type;
     } else {
-        this->report(SemanticErr::TYPE1, self, "variable " + self->identifier + " is used without definition");
+        this->report(SemanticErr::TYPE1, self, "variable " + self->identifier.str() + " is used without definition");
     }
 }
 
@@ -194,10 +192,10 @@ void TypeSynthesizer::leave(CallExp *self, Node *parent) {
             return;
         }
     }
-    optional<Shared<Type>> defined = self->scope->getType(self->identifier);
-    if (defined) {
+    const Symbol *defined = this->symbols.lookup(self->identifier);
+    if (defined != nullptr) {
         try {
-            const FunctionType& funcType = as<FunctionType>(defined.value());
+            const FunctionType& funcType = as<FunctionType>(defined->type);
             bool argMatch = funcType.parameters.size() == self->arguments.size();
             if (argMatch) {
                 for (size_t i = 0; i < funcType.parameters.size(); ++i) {
@@ -207,7 +205,7 @@ void TypeSynthesizer::leave(CallExp *self, Node *parent) {
             if (argMatch) {
                 self->type = funcType.returned;
             } else {
-                this->report(SemanticErr::TYPE9, self, "the arguments of function `" + self->identifier + "' mismatch the declared parameters");
+                this->report(SemanticErr::TYPE9, self, "the arguments of function `" + self->identifier.str() + "' mismatch the declared parameters");
             }
         } catch (const exception& e) {
             this->report(SemanticErr::TYPE11, self, "applying function invocation operator on non-function names");
@@ -238,7 +236,7 @@ void TypeSynthesizer::leave(Dec *self, Node *parent) {
         return;
     }
     if (self->init != nullptr &&
-        *(self->scope->getType(self->declarator->identifier).value()) != *self->init->type
+        *self->declarator->symbol->type != *self->init->type
     ) {
         this->report(SemanticErr::TYPE5, self, "unmatched types on both sides of assignment operator");
     }
@@ -263,9 +261,9 @@ void TypeSynthesizer::leave(BinaryExp *self, Node *parent) {
         this->report(self);
         return;
     }
-    Shared<Type> left = self->left->type, right = self->right->type;
-    if (typeid(left.value()) != typeid(PrimitiveType) ||
-        typeid(right.value()) != typeid(PrimitiveType) ||
+    const Type *left = self->left->type, *right = self->right->type;
+    if (typeid(*left) != typeid(PrimitiveType) ||
+        typeid(*right) != typeid(PrimitiveType) ||
         *left != *right
     ) {
         this->report(SemanticErr::TYPE7, self, "unmatched operands");
@@ -279,12 +277,12 @@ void TypeSynthesizer::leave(MemberExp *self, Node *parent) {
         this->report(self);
         return;
     }
-    Shared<Type> type = self->subject->type;
+    const Type *type = self->subject->type;
     try {
         const StructType& structType = as<StructType>(type);
-        Shared<Type> fieldType = structType.getFieldType(self->member);
+        const Type *fieldType = structType.getFieldType(self->member);
         if (fieldType == nullptr) {
-            this->report(SemanticErr::TYPE14, self, "accessing an undefined structure member `" + self->member + "'");
+            this->report(SemanticErr::TYPE14, self, "accessing an undefined structure member `" + self->member.str() + "'");
         } else {
             self->type = fieldType;
         }
@@ -298,8 +296,8 @@ void TypeSynthesizer::leave(ArrayExp *self, Node *parent) {
         this->report(self);
         return;
     }
-    const auto *arrayType = dynamic_cast<const ArrayType*>(self->subject->type.get());
-    const auto *indexType = dynamic_cast<const PrimitiveType*>(self->index->type.get());
+    const auto *arrayType = dynamic_cast<const ArrayType*>(self->subject->type);
+    const auto *indexType = dynamic_cast<const PrimitiveType*>(self->index->type);
     if (arrayType == nullptr) {
         this->report(SemanticErr::TYPE10, self, "applying indexing operator on non-array type variables");
     }
@@ -7,20 +7,12 @@
 #include <unordered_set>
 #include "ast.hpp"
 #include "semantic_err.hpp"
+#include "stats.hpp"
 
 namespace smt {
 
-std::vector<SemanticErrRecord> analyzeSemantic(ast::Program *ast);
-
-class ScopeSetter: public ast::Visitor {
-public:
-    void defaultEnter(ast::Node *, ast::Node *) override;
-    void enter(ast::Program *, ast::Node *) override;
-    void enter(ast::FunDef *, ast::Node *) override;
-    void enter(ast::ForStmt *, ast::Node *) override;
-    void enter(ast::CompoundStmt *, ast::Node *) override;
-};
-
+// each traversal is timed if `stats' is given
+std::vector<SemanticErrRecord> analyzeSemantic(ast::Program *ast, Stats *stats = nullptr);
 
 class SemanticAnalyzer: public ast::Visitor {
 public:
@@ -39,10 +31,11 @@ private:
 
 class StructInitializer final: public SemanticAnalyzer {
 private:
-    std::unordered_map<std::string, Shared<Type>> structures;
+    TypeContext& types;
+    std::unordered_map<Ident, StructType*> structures;
 public:
-    explicit StructInitializer(std::vector<SemanticErrRecord>& errStore):
-        SemanticAnalyzer(errStore) {}
+    StructInitializer(std::vector<SemanticErrRecord>& errStore, TypeContext& types):
+        SemanticAnalyzer(errStore), types(types) {}
     void enter(ast::StructDef *, ast::Node *) override;
     void leave(ast::StructDef *, ast::Node *) override;
     void enter(ast::StructSpecifier *, ast::Node *) override;
@@ -50,17 +43,25 @@ public:
 
 
 // after struct initializer finishes its walk
+// it also opens and closes scopes on the symbol table, so it must run before the type synthesizer
 class SymbolSetter final: public SemanticAnalyzer {
 private:
-    std::unordered_map<unsigned, Shared<Type>> typeRefs;
+    TypeContext& types;
+    SymbolTable& symbols;
+    std::unordered_map<unsigned, const Type *> typeRefs;
 public:
-    explicit SymbolSetter(std::vector<SemanticErrRecord>& errStore):
-        SemanticAnalyzer(errStore) {}
+    SymbolSetter(std::vector<SemanticErrRecord>& errStore, TypeContext& types, SymbolTable& symbols):
+        SemanticAnalyzer(errStore), types(types), symbols(symbols) {}
     void enter(ast::Program *, ast::Node *) override;
     void enter(ast::ExtVarDef *, ast::Node *) override;
     void enter(ast::ParamDec *, ast::Node *) override;
     void enter(ast::FunDef *, ast::Node *) override;
+    void leave(ast::FunDef *, ast::Node *) override;
     void enter(ast::FunDec *, ast::Node *) override;
+    void enter(ast::CompoundStmt *, ast::Node *) override;
+    void leave(ast::CompoundStmt *, ast::Node *) override;
+    void enter(ast::ForStmt *, ast::Node *) override;
+    void leave(ast::ForStmt *, ast::Node *) override;
     void enter(ast::Def *, ast::Node *) override;
     void enter(ast::Dec *, ast::Node *) override;
     void leave(ast::VarDec *, ast::Node *) override;
@@ -71,10 +72,11 @@ public:
 // currently it synthesizes and checks types
 class TypeSynthesizer final: public SemanticAnalyzer {
 private:
-    std::unordered_map<unsigned, Shared<Type>> funcReturnTypes;
+    SymbolTable& symbols;
+    std::unordered_map<unsigned, const Type *> funcReturnTypes;
 public:
-    explicit TypeSynthesizer(std::vector<SemanticErrRecord>& errStore):
-        SemanticAnalyzer(errStore) {}
+    TypeSynthesizer(std::vector<SemanticErrRecord>& errStore, SymbolTable& symbols):
+        SemanticAnalyzer(errStore), symbols(symbols) {}
     void leave(ast::IdExp *, ast::Node *) override;
     void leave(ast::CallExp *, ast::Node *) override;
     void leave(ast::AssignExp *, ast::Node *) override;
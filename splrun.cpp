@@ -0,0 +1,53 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "interpreter.hpp"
+#include "ir_binary.hpp"
+#include "ir_reader.hpp"
+
+using namespace std;
+
+
+static ir::Code load(const string& path) {
+    ifstream in(path, ios::binary);
+    if (!in) throw runtime_error("cannot open " + path);
+    char magic[sizeof(ir::binary::MAGIC)] = {};
+    in.read(magic, sizeof(magic));
+    if (ir::isBinaryIr(string_view(magic, in.gcount()))) return ir::MappedIr(path).toCode();
+    in.clear();
+    in.seekg(0);
+    try {
+        return ir::readIr(in);
+    } catch (const runtime_error& e) {
+        throw runtime_error(path + ": " + e.what());
+    }
+}
+
+// runs IR in either form with stdin and stdout, and exits with the return value of main
+int main(int argc, const char ** argv) {
+    bool count = false;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--count") == 0) count = true;
+        else if (path == nullptr) path = argv[i];
+        else path = "";
+    }
+    if (path == nullptr || *path == '\0') {
+        cerr << "Usage:\n\t" << argv[0] << " [--count] program.ir < input" << endl;
+        return 1;
+    }
+
+    try {
+        ir::Interpreter interpreter(load(path));
+        int status = interpreter.run(cin, cout);
+        cout.flush();
+        if (count) cerr << interpreter.executed() << " instructions executed" << endl;
+        return status;
+    } catch (const exception& e) {
+        cout.flush();
+        cerr << argv[0] << ": " << e.what() << endl;
+        return 1;
+    }
+}
@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include "cfg.hpp"
+#include "optimizer.hpp"
+#include "ssa.hpp"
+
+using namespace ir;
+using namespace std;
+
+
+SsaForm::SsaForm(Code& code): code(code) {
+    auto untracked = untrackedPlaces(code);
+    firstName = max<size_t>(untracked.size(), 1);
+    for (auto& range: functionRanges(code)) build(range.first, range.second, untracked);
+}
+
+Operand SsaForm::newName(Operand place) {
+    origins.push_back(originOf(place).value());
+    return place.withValue(firstName + origins.size() - 1);
+}
+
+void SsaForm::build(size_t first, size_t last, const vector<bool>& untracked) {
+    Cfg cfg(code, first, last);
+    auto tracked = [&](Operand operand) {
+        return operand.isPlace() && operand.value() < firstName && !untracked[operand.value()];
+    };
+
+    // unreachable blocks are dropped
+    vector<uint32_t> indices(cfg.size(), Cfg::NO_BLOCK);
+    SsaFunction function;
+    auto& blocks = function.blocks;
+    for (uint32_t b = 0; b < cfg.size(); ++b) {
+        if (!cfg.reachable(b)) continue;
+        indices[b] = blocks.size();
+        blocks.emplace_back();
+        blocks.back().tacs.assign(code.tacs.begin() + cfg[b].first, code.tacs.begin() + cfg[b].last);
+    }
+    for (uint32_t b = 0; b < cfg.size(); ++b) {
+        if (!cfg.reachable(b)) continue;
+        auto& block = blocks[indices[b]];
+        block.idom = indices[cfg[b].idom];
+        for (auto pred: cfg[b].preds) {
+            if (cfg.reachable(pred)) block.preds.push_back(indices[pred]);
+        }
+        for (auto succ: cfg[b].succs) block.succs.push_back(indices[succ]);
+    }
+
+    // dominance frontiers, as by Cooper, Harvey and Kennedy
+    vector<vector<uint32_t>> frontiers(blocks.size());
+    for (uint32_t b = 0; b < blocks.size(); ++b) {
+        if (blocks[b].preds.size() < 2) continue;
+        for (auto runner: blocks[b].preds) {
+            for (; runner != blocks[b].idom; runner = blocks[runner].idom) {
+                auto& frontier = frontiers[runner];
+                if (frontier.empty() || frontier.back() != b) frontier.push_back(b);
+            }
+        }
+    }
+
+    // only places read in other blocks than the ones assigning them need phis
+    vector<Operand> places;                         // assigned in the function
+    unordered_map<uint32_t, vector<uint32_t>> defBlocks;
+    unordered_map<uint32_t, bool> live;             // across blocks
+    for (uint32_t b = 0; b < blocks.size(); ++b) {
+        unordered_map<uint32_t, bool> assigned;
+        for (auto& tac: blocks[b].tacs) {
+            forEachUse(tac, [&](Operand operand, bool) {
+                if (tracked(operand) && !assigned[operand.value()]) live[operand.value()] = true;
+            });
+            if (!writesResult(tac.op) || !tracked(tac.result)) continue;
+            uint32_t place = tac.result.value();
+            if (assigned[place]) continue;
+            assigned[place] = true;
+            auto& defs = defBlocks[place];
+            if (defs.empty()) places.push_back(tac.result);
+            defs.push_back(b);
+        }
+    }
+    vector<uint32_t> hasPhi(blocks.size()), inWork(blocks.size());     // stamped with the place + 1
+    for (auto operand: places) {
+        uint32_t place = operand.value();
+        if (!live[place]) continue;
+        auto work = defBlocks[place];
+        for (auto b: work) inWork[b] = place + 1;
+        while (!work.empty()) {
+            uint32_t b = work.back();
+            work.pop_back();
+            for (auto d: frontiers[b]) {
+                if (hasPhi[d] == place + 1) continue;
+                hasPhi[d] = place + 1;
+                blocks[d].phis.push_back({ operand, vector<Operand>(blocks[d].preds.size(), operand) });
+                if (inWork[d] != place + 1) {
+                    inWork[d] = place + 1;
+                    work.push_back(d);
+                }
+            }
+        }
+    }
+
+    // renaming, over the dominator tree from the entry
+    vector<vector<uint32_t>> children(blocks.size());
+    for (uint32_t b = 1; b < blocks.size(); ++b) children[blocks[b].idom].push_back(b);
+    unordered_map<uint32_t, vector<Operand>> names;     // stacks of current names of places
+    vector<uint32_t> pushed;                            // places whose names were pushed, in order
+    vector<pair<uint32_t, size_t>> walk { { 0, SIZE_MAX } };  // blocks, with the size of `pushed' before them
+    auto current = [&](Operand operand) {
+        if (!tracked(operand)) return operand;
+        auto found = names.find(operand.value());
+        return found == names.end() || found->second.empty() ? operand : found->second.back();
+    };
+    auto define = [&](Operand& place) {
+        Operand name = newName(place);
+        names[place.value()].push_back(name);
+        pushed.push_back(place.value());
+        place = name;
+    };
+    while (!walk.empty()) {
+        auto& top = walk.back();
+        uint32_t b = top.first;
+        if (top.second != SIZE_MAX) {
+            // leaving the subtree of the block
+            for (size_t n = pushed.size() - top.second; n > 0; --n) {
+                names[pushed.back()].pop_back();
+                pushed.pop_back();
+            }
+            walk.pop_back();
+            continue;
+        }
+        top.second = pushed.size();
+
+        auto& block = blocks[b];
+        for (auto& phi: block.phis) define(phi.result);
+        for (auto& tac: block.tacs) {
+            forEachUse(tac, [&](Operand& operand, bool) { operand = current(operand); });
+            if (writesResult(tac.op) && tracked(tac.result)) define(tac.result);
+        }
+        for (auto succ: block.succs) {
+            auto& preds = blocks[succ].preds;
+            size_t j = find(preds.begin(), preds.end(), b) - preds.begin();
+            for (auto& phi: blocks[succ].phis) phi.args[j] = current(originOf(phi.result));
+        }
+        for (auto child: children[b]) walk.emplace_back(child, SIZE_MAX);
+    }
+
+    functions.push_back(move(function));
+}
+
+void SsaForm::lower() {
+    vector<Tac> tacs;
+    for (auto& function: functions) {
+        auto& blocks = function.blocks;
+        // a phi can be assigned at the ends of its predecessors when each of them goes on to its block only,
+        // and neither the jump there nor the other phis read it; otherwise the predecessors copy into a fresh place,
+        // which is copied into the phi at the start of its block, so that phis reading each other keep their values
+        auto direct = [&](uint32_t b, const Phi& phi) {
+            for (size_t j = 0; j < phi.args.size(); ++j) {
+                auto& pred = blocks[blocks[b].preds[j]];
+                if (pred.succs.size() != 1) return false;
+                bool read = false;
+                Tac jump = pred.tacs.back();
+                if (isJump(jump.op)) forEachUse(jump, [&](Operand operand, bool) { read = read || operand == phi.result; });
+                for (auto& other: blocks[b].phis) read = read || (&other != &phi && other.args[j] == phi.result);
+                if (read) return false;
+            }
+            return true;
+        };
+        vector<vector<Tac>> tails(blocks.size()), heads(blocks.size());
+        for (uint32_t b = 0; b < blocks.size(); ++b) {
+            for (auto& phi: blocks[b].phis) {
+                Operand target = direct(b, phi) ? phi.result : newName(phi.result);
+                for (size_t j = 0; j < phi.args.size(); ++j) {
+                    tails[blocks[b].preds[j]].push_back({ Opcode::ASSIGN, target, phi.args[j], {} });
+                }
+                if (target != phi.result) heads[b].push_back({ Opcode::ASSIGN, phi.result, target, {} });
+            }
+        }
+
+        for (uint32_t b = 0; b < blocks.size(); ++b) {
+            auto& block = blocks[b].tacs;
+            auto end = block.end();
+            if (isJump(block.back().op)) --end;
+            auto begin = block.begin();
+            if (begin->op == Opcode::LABEL) ++begin;
+            tacs.insert(tacs.end(), block.begin(), begin);
+            tacs.insert(tacs.end(), heads[b].begin(), heads[b].end());
+            tacs.insert(tacs.end(), begin, end);
+            tacs.insert(tacs.end(), tails[b].begin(), tails[b].end());
+            tacs.insert(tacs.end(), end, block.end());
+        }
+    }
+    code.tacs = move(tacs);
+    functions.clear();
+}
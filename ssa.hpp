@@ -0,0 +1,69 @@
+#ifndef SSA_HPP
+#define SSA_HPP
+
+#include <cstdint>
+#include <vector>
+#include "tac.hpp"
+
+
+namespace ir {
+
+// value chosen by the predecessor that control comes from
+struct Phi {
+    Operand result;
+    std::vector<Operand> args;  // in the order of the predecessors of the block
+};
+
+struct SsaBlock {
+    std::vector<Phi> phis;
+    std::vector<Tac> tacs;
+    std::vector<uint32_t> preds, succs;
+    uint32_t idom;              // immediate dominator, which is the entry itself for the entry
+};
+
+// reachable blocks of a function, in the order of their code, so the entry comes first
+struct SsaFunction {
+    std::vector<SsaBlock> blocks;
+};
+
+/**
+ * Static single assignment form of a program, with phis placed on the dominance frontiers of the
+ * blocks that assign places read in other blocks.
+ * Places a function can track (see untrackedPlaces) are renamed, so that each of them is assigned once,
+ * by an instruction or a phi; reads that no assignment reaches keep the original place.
+ * Places shared by functions, declared by DEC or whose address is taken are left as they are.
+ */
+class SsaForm {
+private:
+    Code& code;
+    std::vector<uint32_t> origins;  // place each name stands for, by the number of the name
+    uint32_t firstName;
+
+    void build(size_t first, size_t last, const std::vector<bool>& untracked);
+
+public:
+    std::vector<SsaFunction> functions;
+
+    // the code keeps the constants that instructions in SSA form refer to
+    explicit SsaForm(Code& code);
+
+    // a place not assigned yet, of the same kind as `place', which stands for the same origin
+    Operand newName(Operand place);
+
+    // whether the operand is a name given in SSA form, rather than a place left as it was
+    bool isName(Operand operand) const {
+        return operand.isPlace() && operand.value() >= firstName;
+    }
+
+    // the original place of a name
+    Operand originOf(Operand name) const {
+        return name.value() >= firstName ? name.withValue(origins[name.value() - firstName]) : name;
+    }
+
+    // replaces the code by plain instructions again, where each phi becomes copies at the ends of the predecessors
+    void lower();
+};
+
+} // namespace ir
+
+#endif // SSA_HPP
@@ -0,0 +1,91 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <chrono>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Wall time of the compilation phases of a source, and counters of what they produced,
+ * printed as text or as a single-line JSON object by `splc --stats`.
+ */
+class Stats {
+private:
+    std::string source;
+    std::vector<std::pair<std::string, double>> phases;     // seconds, in order of execution
+    std::vector<std::pair<std::string, size_t>> counters;   // in order of recording
+
+    static void writeJsonStr(std::ostream& out, const std::string& str) {
+        out << '"';
+        for (char c: str) {
+            if (c == '"' || c == '\\') {
+                out << '\\' << c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out << escaped;
+            } else {
+                out << c;
+            }
+        }
+        out << '"';
+    }
+
+public:
+    explicit Stats(std::string source): source(std::move(source)) {}
+
+    // the phase is recorded even if it throws
+    template <typename Phase>
+    auto time(const std::string& name, Phase&& phase) -> decltype(phase()) {
+        struct Recorder {
+            Stats& stats;
+            const std::string& name;
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            ~Recorder() {
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                stats.phases.emplace_back(name, elapsed.count());
+            }
+        } recorder { *this, name };
+        return phase();
+    }
+
+    void count(const std::string& name, size_t value) {
+        counters.emplace_back(name, value);
+    }
+
+    void print(std::ostream& out) const {
+        out << "statistics of " << source << ":\n";
+        char line[128];
+        for (auto& phase: phases) {
+            std::snprintf(line, sizeof(line), "  %-24s %12.3f ms\n", phase.first.c_str(), phase.second * 1e3);
+            out << line;
+        }
+        for (auto& counter: counters) {
+            std::snprintf(line, sizeof(line), "  %-24s %12zu\n", counter.first.c_str(), counter.second);
+            out << line;
+        }
+    }
+
+    void printJson(std::ostream& out) const {
+        out << "{\"source\":";
+        writeJsonStr(out, source);
+        out << ",\"phases\":{";
+        for (size_t i = 0; i < phases.size(); ++i) {
+            if (i > 0) out << ',';
+            writeJsonStr(out, phases[i].first);
+            out << ':' << phases[i].second;
+        }
+        out << "},\"counters\":{";
+        for (size_t i = 0; i < counters.size(); ++i) {
+            if (i > 0) out << ',';
+            writeJsonStr(out, counters[i].first);
+            out << ':' << counters[i].second;
+        }
+        out << "}}\n";
+    }
+};
+
+#endif // STATS_HPP
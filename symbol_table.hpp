@@ -1,83 +1,140 @@
 #ifndef SYMBOL_TABLE_HPP
 #define SYMBOL_TABLE_HPP
 
-#include <map>
-#include <optional>
-#include <string>
-#include <typeinfo>
-#include <utility>
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+#include <vector>
+#include "ident.hpp"
 #include "type.hpp"
-#include "utils.hpp"
 
 namespace smt {
 
 
 struct Symbol {
-    Shared<Type> type;
-    int symbolId;
+    Ident name;
+    const Type * type;
+    unsigned depth;     // nesting depth of the scope it is declared in
+    int shadowed;       // index of the symbol it hides in an outer scope, or -1
 };
 
 
+/**
+ * Scoped symbol table, kept as a stack of scopes during a single walk of the AST.
+ * One open-addressing hash maps each name to the innermost visible symbol,
+ * and every symbol links to the one it shadows, so that lookup doesn't depend on the depth of nesting.
+ * Symbols are never freed before the table, so they can be referenced from the AST.
+ */
 class SymbolTable {
 private:
-    std::map<std::string, Symbol> table;
-    std::shared_ptr<SymbolTable> parent;
+    struct Slot {
+        uint32_t key;   // Ident value, or EMPTY
+        int head;       // innermost visible symbol, or -1 once its scope is closed
+    };
+
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    std::deque<Symbol> symbols;
+    std::vector<Slot> slots = std::vector<Slot>(64, Slot { EMPTY, -1 });
+    size_t keys = 0;
+    std::vector<int> declared;          // symbols of the open scopes, in order of declaration
+    std::vector<size_t> scopeMarks;     // size of `declared' when each inner scope was opened
+    size_t scopeNum = 1;
+
+    Slot& slotOf(uint32_t key) {
+        size_t mask = slots.size() - 1;
+        size_t i = (key * 0x9E3779B9u) & mask;
+        while (slots[i].key != EMPTY && slots[i].key != key) {
+            i = (i + 1) & mask;
+        }
+        return slots[i];
+    }
 
-    inline static int globalSymbolSeq = 0;
-    inline static int globalLabelSeq = 0;
+    const Slot& slotOf(uint32_t key) const {
+        return const_cast<SymbolTable*>(this)->slotOf(key);
+    }
 
-    Symbol& getSymbol(const std::string& identifier) {
-        auto found = table.find(identifier);
-        if (found != table.end()) return found->second;
-        if (parent != nullptr) return parent->getSymbol(identifier);
-        throw std::invalid_argument("identifier not found");
+    void grow() {
+        std::vector<Slot> old(slots.size() * 2, Slot { EMPTY, -1 });
+        old.swap(slots);
+        for (const Slot& slot: old) {
+            if (slot.key != EMPTY) slotOf(slot.key) = slot;
+        }
     }
 
 public:
     SymbolTable() = default;
-    explicit SymbolTable(std::shared_ptr<SymbolTable> parent):
-        parent(std::move(parent)) {}
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    void pushScope() {
+        ++scopeNum;
+        scopeMarks.push_back(declared.size());
+    }
 
-    void setType(const std::string& identifier, const Shared<Type>& type) {
-        table[identifier] = Symbol { type, 0 };
+    void popScope() {
+        if (scopeMarks.empty()) throw std::logic_error("the global scope cannot be closed");
+        for (size_t i = declared.size(); i > scopeMarks.back(); --i) {
+            const Symbol& symbol = symbols[declared[i - 1]];
+            slotOf(symbol.name.value()).head = symbol.shadowed;
+        }
+        declared.resize(scopeMarks.back());
+        scopeMarks.pop_back();
     }
 
-    std::optional<Shared<Type>> getType(const std::string& identifier) {
-        auto found = table.find(identifier);
-        if (found != table.end()) return found->second.type;
-        if (parent != nullptr) return parent->getType(identifier);
-        return std::nullopt;
+    unsigned depth() const {
+        return scopeMarks.size();
     }
 
-    int getId(const std::string& identifier) {
-        auto& symbol = getSymbol(identifier);
-        return symbol.symbolId > 0 ? symbol.symbolId : (symbol.symbolId = ++globalSymbolSeq);
+    // redeclaring a name in the same scope replaces the type of its symbol
+    Symbol& declare(Ident name, const Type * type) {
+        if (2 * (keys + 1) > slots.size()) grow();
+        Slot& slot = slotOf(name.value());
+        if (slot.key == EMPTY) {
+            slot.key = name.value();
+            ++keys;
+        } else if (slot.head >= 0 && symbols[slot.head].depth == depth()) {
+            symbols[slot.head].type = type;
+            return symbols[slot.head];
+        }
+        symbols.push_back(Symbol { name, type, depth(), slot.head });
+        slot.head = symbols.size() - 1;
+        declared.push_back(slot.head);
+        return symbols.back();
     }
 
-    static int createPlace() {
-        return ++globalSymbolSeq;
+    Symbol * lookup(Ident name) {
+        int head = slotOf(name.value()).head;
+        return head >= 0 ? &symbols[head] : nullptr;
     }
 
-    static int createLabel() {
-        return ++globalLabelSeq;
+    const Symbol * lookup(Ident name) const {
+        int head = slotOf(name.value()).head;
+        return head >= 0 ? &symbols[head] : nullptr;
     }
 
+    // number of symbols declared in the open scopes, including shadowed ones
     size_t size() const {
-        return table.size() + (parent == nullptr ? 0 : parent->size());
+        return declared.size();
+    }
+
+    // scopes ever opened, including the global one
+    size_t scopeCount() const {
+        return scopeNum;
     }
 
-    bool isLowerThan(const std::shared_ptr<SymbolTable>& scope) const {
-        if (scope.get() == this) return true;
-        if (parent != nullptr) return parent->isLowerThan(scope);
-        return false;
+    // symbols ever declared
+    size_t symbolCount() const {
+        return symbols.size();
     }
 
-    bool canOverwrite(const std::string& name) const {
-        return table.find(name) == table.end();
+    bool canOverwrite(Ident name) const {
+        const Symbol *symbol = lookup(name);
+        return symbol == nullptr || symbol->depth != depth();
     }
 };
 
-} // end of namespace ast
+} // end of namespace smt
 
 
 #endif // SYMBOL_TABLE_HPP
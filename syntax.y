@@ -1,3 +1,24 @@
+%code requires {
+
+#include "ast.hpp"
+
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void * yyscan_t;
+#endif
+
+// state of a single parse, shared by the parser and its scanner (as yyextra)
+struct ParserContext {
+    yyscan_t scanner = nullptr;
+    ast::Program * program = nullptr;
+    bool hasErr = false;
+    int colno = 1;      // column of the next lexeme
+    int prevState = 0;  // start condition to return to at the end of a block comment
+    size_t tokens = 0;  // scanned so far, including the end of input
+};
+
+}
+
 %{
 
 #include <cstdio>
@@ -5,24 +26,34 @@
 #include <memory>
 #include <string>
 #include "ast.hpp"
+#include "mapped_source.hpp"
 #include "parser.hpp"
 #include "syntax_err.hpp"
 #include "utils.hpp"
 
-extern "C" int yylex(void);
-static void yyerror(const char *);
-static void reportSynErr(int, SyntaxErr);
+%}
+
+%code {
 
-extern FILE * yyin;
-static ast::Program * program;
-static bool hasErr;
+int yylex(YYSTYPE *, YYLTYPE *, yyscan_t);
+static void yyerror(YYLTYPE *, yyscan_t, ParserContext *, const char *);
+static void reportSynErr(ParserContext *, int, SyntaxErr);
 
+// reentrant interface of the scanner generated from lex.l
 struct yy_buffer_state;
 typedef struct yy_buffer_state * YY_BUFFER_STATE;
-extern YY_BUFFER_STATE yy_scan_string(const char * str);
-extern void yy_delete_buffer(YY_BUFFER_STATE buffer);
+extern int yylex_init_extra(ParserContext * extra, yyscan_t * scanner);
+extern int yylex_destroy(yyscan_t scanner);
+extern void yyset_in(FILE * file, yyscan_t scanner);
+extern YY_BUFFER_STATE yy_scan_string(const char * str, yyscan_t scanner);
+extern YY_BUFFER_STATE yy_scan_buffer(char * base, size_t size, yyscan_t scanner);
+extern void yy_delete_buffer(YY_BUFFER_STATE buffer, yyscan_t scanner);
 
-%}
+}
+
+%define api.pure full
+%param {yyscan_t scanner}
+%parse-param {ParserContext * ctx}
 
 %locations
 
@@ -31,8 +62,8 @@ extern void yy_delete_buffer(YY_BUFFER_STATE buffer);
 %token <int> INT
 %token <double> FLOAT
 %token <char> CHAR
-%token <std::string *> TYPE
-%token <std::string *> ID
+%token <smt::Primitive> TYPE
+%token <Ident> ID
 %token STRUCT
 %token IF ELSE WHILE FOR RETURN SEMI
 %token DOT COMMA ASSIGN LT LE GT GE NE EQ PLUS MINUS MUL DIV AND OR NOT
@@ -81,7 +112,7 @@ extern void yy_delete_buffer(YY_BUFFER_STATE buffer);
 /* high-level definition */
 Program:
     ExtDefList {
-        program = $$ = new ast::Program(*$1);
+        ctx->program = $$ = new ast::Program(*$1);
         delete $1;
         $$->setLocation(&@$);
         }
@@ -96,7 +127,7 @@ ExtDefList:
         }
     | LEX_ERR_BLK {
         $$ = new std::list<ast::ExtDef*>;
-        hasErr = true;
+        ctx->hasErr = true;
         }
     ;
 ExtDef:
@@ -116,11 +147,11 @@ ExtDef:
     | Specifier ExtDecList %prec ERROR {
         $$ = new ast::ExtVarDef($1, *$2);
         delete $2;
-        reportSynErr(@2.last_line, SyntaxErr::MISSING_SEMI);
+        reportSynErr(ctx, @2.last_line, SyntaxErr::MISSING_SEMI);
         }
     | Specifier %prec ERROR {
         $$ = new ast::StructDef($1);
-        reportSynErr(@$.last_line, SyntaxErr::MISSING_SEMI);
+        reportSynErr(ctx, @$.last_line, SyntaxErr::MISSING_SEMI);
         }
     ;
 ExtDecList:
@@ -136,8 +167,7 @@ ExtDecList:
 /* specifier */
 Specifier:
     TYPE {
-        $$ = new ast::PrimitiveSpecifier(*$1);
-        delete $1;
+        $$ = new ast::PrimitiveSpecifier($1);
         $$->setLocation(&@$);
         }
     | StructSpecifier {
@@ -147,13 +177,12 @@ Specifier:
     ;
 StructSpecifier:
     STRUCT ID LC DefList RC {
-        $$ = new ast::StructSpecifier(*$2, *$4);
-        deleteAll($2, $4);
+        $$ = new ast::StructSpecifier($2, *$4);
+        delete $4;
         $$->setLocation(&@$);
         }
     | STRUCT ID {
-        $$ = new ast::StructSpecifier(*$2);
-        delete $2;
+        $$ = new ast::StructSpecifier($2);
         $$->setLocation(&@$);
         }
     ;
@@ -161,8 +190,7 @@ StructSpecifier:
 /* declarator */
 VarDec:
     ID {
-        $$ = new ast::VarDec(*$1);
-        delete $1;
+        $$ = new ast::VarDec($1);
         $$->setLocation(&@$);
         }
     | VarDec LB INT RB {
@@ -172,39 +200,36 @@ VarDec:
         }
     | LEX_ERR %prec ERROR {
         $$ = new ast::VarDec("#err");
-        hasErr = true;
+        ctx->hasErr = true;
         }
     | VarDec LB INT %prec ERROR {
         $$ = new ast::ArrDec(*$1, $3);
         delete $1;
-        reportSynErr(@3.last_line, SyntaxErr::MISSING_RB);
+        reportSynErr(ctx, @3.last_line, SyntaxErr::MISSING_RB);
         }
     ;
 FunDec:
     ID LP VarList RP {
-        $$ = new ast::FunDec(*$1, *$3);
-        deleteAll($1, $3);
+        $$ = new ast::FunDec($1, *$3);
+        delete $3;
         $$->setLocation(&@$);
         }
     | ID LP RP {
-        $$ = new ast::FunDec(*$1);
-        delete $1;
+        $$ = new ast::FunDec($1);
         $$->setLocation(&@$);
         }
     | ID LP VarList %prec ERROR {
-        $$ = new ast::FunDec(*$1, *$3);
-        deleteAll($1, $3);
-        reportSynErr(@3.last_line, SyntaxErr::MISSING_RP);
+        $$ = new ast::FunDec($1, *$3);
+        delete $3;
+        reportSynErr(ctx, @3.last_line, SyntaxErr::MISSING_RP);
         }
     | ID LP %prec ERROR {
-        $$ = new ast::FunDec(*$1);
-        delete $1;
-        reportSynErr(@2.last_line, SyntaxErr::MISSING_RP);
+        $$ = new ast::FunDec($1);
+        reportSynErr(ctx, @2.last_line, SyntaxErr::MISSING_RP);
         }
     | ID RP %prec ERROR {
-        $$ = new ast::FunDec(*$1);
-        delete $1;
-        reportSynErr(@2.first_line, SyntaxErr::MISSING_LP);
+        $$ = new ast::FunDec($1);
+        reportSynErr(ctx, @2.first_line, SyntaxErr::MISSING_LP);
         }
     ;
 VarList:
@@ -243,7 +268,7 @@ StmtList:
         $3->push_front($1);
         $$ = $3;
         delete $2;
-        reportSynErr(@1.last_line, SyntaxErr::DEC_STMT_ORDER);
+        reportSynErr(ctx, @1.last_line, SyntaxErr::DEC_STMT_ORDER);
         }
     ;
 Stmt:
@@ -305,15 +330,15 @@ Stmt:
         }
     | Exp %prec ERROR {
         $$ = new ast::ExpStmt($1);
-        reportSynErr(@$.last_line, SyntaxErr::MISSING_SEMI);
+        reportSynErr(ctx, @$.last_line, SyntaxErr::MISSING_SEMI);
         }
     | RETURN Exp %prec ERROR {
         $$ = new ast::ReturnStmt($2);
-        reportSynErr(@2.last_line, SyntaxErr::MISSING_SEMI);
+        reportSynErr(ctx, @2.last_line, SyntaxErr::MISSING_SEMI);
         }
     | LEX_ERR_BLK %prec ERROR {
         $$ = new ast::ReturnStmt();
-        hasErr = true;
+        ctx->hasErr = true;
         }
     | error SEMI %prec ERROR {
         $$ = new ast::ReturnStmt();
@@ -339,7 +364,7 @@ Def:
     | Specifier DecList %prec ERROR {
         $$ = new ast::Def($1, *$2);
         delete $2;
-        reportSynErr(@2.last_line, SyntaxErr::MISSING_SEMI);
+        reportSynErr(ctx, @2.last_line, SyntaxErr::MISSING_SEMI);
         }
     ;
 DecList:
@@ -433,13 +458,12 @@ Exp:
         $$->setLocation(&@$);
         }
     | ID LP Args RP {
-        $$ = new ast::CallExp(*$1, *$3);
-        deleteAll($1, $3);
+        $$ = new ast::CallExp($1, *$3);
+        delete $3;
         $$->setLocation(&@$);
         }
     | ID LP RP {
-        $$ = new ast::CallExp(*$1);
-        delete $1;
+        $$ = new ast::CallExp($1);
         $$->setLocation(&@$);
         }
     | Exp LB Exp RB {
@@ -447,13 +471,11 @@ Exp:
         $$->setLocation(&@$);
         }
     | Exp DOT ID {
-        $$ = new ast::MemberExp($1, *$3);
-        delete $3;
+        $$ = new ast::MemberExp($1, $3);
         $$->setLocation(&@$);
         }
     | ID {
-        $$ = new ast::IdExp(*$1);
-        delete $1;
+        $$ = new ast::IdExp($1);
         $$->setLocation(&@$);
         }
     | INT {
@@ -470,30 +492,29 @@ Exp:
         }
     | LEX_ERR {
         $$ = new ast::IdExp("__lex_err__");
-        hasErr = true;
+        ctx->hasErr = true;
         }
     | Exp LEX_ERR Exp  %prec ERROR {
         deleteAll($1, $3);
         $$ = new ast::IdExp("__lex_err__");
-        hasErr = true;
+        ctx->hasErr = true;
         }
     | LP Exp %prec ERROR {
         $$ = $2;
-        reportSynErr(@2.last_line, SyntaxErr::MISSING_RP);
+        reportSynErr(ctx, @2.last_line, SyntaxErr::MISSING_RP);
         }
     | ID LP Args %prec ERROR {
-        $$ = new ast::CallExp(*$1, *$3);
-        deleteAll($1, $3);
-        reportSynErr(@3.last_line, SyntaxErr::MISSING_RP);
+        $$ = new ast::CallExp($1, *$3);
+        delete $3;
+        reportSynErr(ctx, @3.last_line, SyntaxErr::MISSING_RP);
         }
     | ID LP %prec ERROR {
-        $$ = new ast::CallExp(*$1);
-        delete $1;
-        reportSynErr(@2.last_line, SyntaxErr::MISSING_RP);
+        $$ = new ast::CallExp($1);
+        reportSynErr(ctx, @2.last_line, SyntaxErr::MISSING_RP);
         }
     | Exp LB Exp %prec ERROR {
         $$ = new ast::ArrayExp($1, $3);
-        reportSynErr(@3.last_line, SyntaxErr::MISSING_RB);
+        reportSynErr(ctx, @3.last_line, SyntaxErr::MISSING_RB);
         }
     ;
 
@@ -508,38 +529,62 @@ Args:
     ;
 %%
 
-static void yyerror(const char * msg) {
-    // fprintf(stderr, "Error type B at Line %d: %s\n", yylloc.last_line, msg);
+static void yyerror(YYLTYPE * loc, yyscan_t scanner, ParserContext * ctx, const char * msg) {
+    // fprintf(stderr, "Error type B at Line %d: %s\n", loc->last_line, msg);
     // FIXME: lineno
     fprintf(stderr, "Error type B at Line #: %s\n", msg);
-    hasErr = true;
+    ctx->hasErr = true;
 }
 
-static void reportSynErr(int lineno, SyntaxErr err) {
+static void reportSynErr(ParserContext * ctx, int lineno, SyntaxErr err) {
     fprintf(stderr, "Error type B at Line %d: %s\n", lineno, syntaxErrMsgs[int(err)]);
-    hasErr = true;
+    ctx->hasErr = true;
 }
 
-ast::Program * parseFile(FILE * file) {
-    // yydebug = 1;
-    hasErr = false;
-    yyin = file;
-    if (yyparse() == 0 && !hasErr) {
-        return program;
-    } else {
-        delete program;
-        program = nullptr;
-        return nullptr;
+// unless SPLC_AST_ARENA is turned off, all nodes are allocated in an arena owned by the program
+static ast::Program * parse(ParserContext& ctx) {
+#ifdef SPLC_AST_ARENA
+    auto arena = std::make_unique<ast::NodeArena>();
+    ast::NodeArena::Guard guard(arena.get());
+#endif
+    int status = yyparse(ctx.scanner, &ctx);
+#ifdef SPLC_AST_ARENA
+    if (ctx.program != nullptr) ctx.program->storage = std::move(arena);
+#endif
+    if (status != 0 || ctx.hasErr) {
+        delete ctx.program;
+        ctx.program = nullptr;
     }
+    return ctx.program;
 }
 
-ast::Program * parseStr(const char * src) {
-    hasErr = false;
-    YY_BUFFER_STATE buffer = yy_scan_string(src);
-    if (yyparse() != 0 || hasErr) {
-        delete program;
-        program = nullptr;
+// every call has its own parser and scanner state, so that files can be parsed concurrently
+// regular files are scanned in place from a memory mapping, while pipes and terminals are read through stdio
+ast::Program * parseFile(FILE * file, size_t * tokenNum) {
+    ParserContext ctx;
+    if (yylex_init_extra(&ctx, &ctx.scanner) != 0) throw std::bad_alloc();
+    MappedSource source(file);
+    YY_BUFFER_STATE buffer = source.empty() ? nullptr : yy_scan_buffer(source.data(), source.bufferSize(), ctx.scanner);
+    ast::Program * result;
+    if (buffer != nullptr) {
+        result = parse(ctx);
+        yy_delete_buffer(buffer, ctx.scanner);
+    } else {
+        yyset_in(file, ctx.scanner);
+        result = parse(ctx);
     }
-    yy_delete_buffer(buffer);
-    return program;
+    yylex_destroy(ctx.scanner);
+    if (tokenNum != nullptr) *tokenNum = ctx.tokens;
+    return result;
+}
+
+ast::Program * parseStr(const char * src, size_t * tokenNum) {
+    ParserContext ctx;
+    if (yylex_init_extra(&ctx, &ctx.scanner) != 0) throw std::bad_alloc();
+    YY_BUFFER_STATE buffer = yy_scan_string(src, ctx.scanner);
+    ast::Program * result = parse(ctx);
+    yy_delete_buffer(buffer, ctx.scanner);
+    yylex_destroy(ctx.scanner);
+    if (tokenNum != nullptr) *tokenNum = ctx.tokens;
+    return result;
 }
@@ -0,0 +1,129 @@
+#include <string>
+#include "tac.hpp"
+
+using namespace ir;
+using namespace std;
+
+
+static void printOperand(ostream& out, const Code& code, Operand operand) {
+    switch (operand.kind()) {
+    case Operand::Kind::TEMP:
+    case Operand::Kind::VARIABLE:
+        out << 't' << operand.value();
+        break;
+    case Operand::Kind::CONSTANT: {
+        auto& constant = code.constantOf(operand);
+        out << '#';
+        if (constant.type == Constant::Type::FLOAT) {
+            out << to_string(constant.floatVal);
+        } else {
+            out << constant.intVal;
+        }
+    } break;
+    case Operand::Kind::LABEL:
+        out << "label" << operand.value();
+        break;
+    case Operand::Kind::FUNCTION:
+        out << operand.name();
+        break;
+    case Operand::Kind::NONE:
+        throw invalid_argument("missing operand");
+    }
+}
+
+void Code::print(ostream& out, const Tac& tac) const {
+    auto operand = [&](Operand op) -> ostream& {
+        printOperand(out, *this, op);
+        return out;
+    };
+    auto arith = [&](char opt) {
+        operand(tac.result) << " := ";
+        operand(tac.arg1) << ' ' << opt << ' ';
+        operand(tac.arg2);
+    };
+    auto branch = [&](const char *relop) {
+        out << "IF ";
+        operand(tac.arg1) << ' ' << relop << ' ';
+        operand(tac.arg2) << " GOTO ";
+        operand(tac.result);
+    };
+
+    switch (tac.op) {
+    case Opcode::LABEL:
+        out << "LABEL ";
+        operand(tac.result) << " :";
+        break;
+    case Opcode::FUNCTION:
+        out << "FUNCTION ";
+        operand(tac.result) << " :";
+        break;
+    case Opcode::ASSIGN:
+        operand(tac.result) << " := ";
+        operand(tac.arg1);
+        break;
+    case Opcode::ADD: arith('+'); break;
+    case Opcode::SUB: arith('-'); break;
+    case Opcode::MUL: arith('*'); break;
+    case Opcode::DIV: arith('/'); break;
+    case Opcode::ADDR:
+        operand(tac.result) << " := &";
+        operand(tac.arg1);
+        break;
+    case Opcode::FETCH:
+        operand(tac.result) << " := *";
+        operand(tac.arg1);
+        break;
+    case Opcode::DEREF:
+        out << '*';
+        operand(tac.result) << " := ";
+        operand(tac.arg1);
+        break;
+    case Opcode::GOTO:
+        out << "GOTO ";
+        operand(tac.result);
+        break;
+    case Opcode::IF_LT: branch("<"); break;
+    case Opcode::IF_LE: branch("<="); break;
+    case Opcode::IF_GT: branch(">"); break;
+    case Opcode::IF_GE: branch(">="); break;
+    case Opcode::IF_NE: branch("!="); break;
+    case Opcode::IF_EQ: branch("=="); break;
+    case Opcode::RETURN:
+        out << "RETURN ";
+        operand(tac.arg1);
+        break;
+    case Opcode::DEC:
+        out << "DEC ";
+        operand(tac.result) << ' ' << constantOf(tac.arg1).intVal;
+        break;
+    case Opcode::PARAM:
+        out << "PARAM ";
+        operand(tac.result);
+        break;
+    case Opcode::ARG:
+        out << "ARG ";
+        operand(tac.arg1);
+        break;
+    case Opcode::CALL:
+        operand(tac.result) << " := CALL ";
+        operand(tac.arg1);
+        break;
+    case Opcode::READ:
+        out << "READ ";
+        operand(tac.result);
+        break;
+    case Opcode::WRITE:
+        out << "WRITE ";
+        operand(tac.arg1);
+        break;
+    }
+}
+
+
+ostream& operator<<(ostream& out, const Code& code) {
+    for (auto& tac: code.tacs) {
+        code.print(out, tac);
+        out << '\n';
+    }
+    return out;
+}
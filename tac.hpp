@@ -1,289 +1,240 @@
 #ifndef TAC_HPP
 #define TAC_HPP
 
+#include <cstdint>
+#include <cstring>
 #include <ostream>
-#include <string>
-#include <memory>
-#include <utility>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include "ident.hpp"
 
 
 namespace ir {
 
+// operand of an instruction: a kind in the top 3 bits, and a 29-bit number
+class Operand {
+public:
+    enum class Kind: uint8_t {
+        NONE,
+        TEMP,       // temporaries and variables are numbered from the same sequence
+        VARIABLE,
+        CONSTANT,   // index into the constant pool of the code
+        LABEL,
+        FUNCTION,   // value of the interned name
+    };
 
-struct TacOperand {
-    virtual std::string toString() const = 0;
-};
+private:
+    static constexpr unsigned VALUE_BITS = 29;
+    static constexpr uint32_t VALUE_MASK = (1u << VALUE_BITS) - 1;
 
-struct VariableOperand final: public TacOperand {
-    int id;
+    uint32_t bits = 0;
 
-    explicit VariableOperand(int id): id(id) {}
-    std::string toString() const override {
-        return 't' + std::to_string(id);
+    Operand(Kind kind, uint32_t value): bits(static_cast<uint32_t>(kind) << VALUE_BITS | value) {
+        if (value > VALUE_MASK) throw std::overflow_error("too many operands");
     }
-};
 
-template <typename T>
-struct ConstantOperand final: public TacOperand {
-    T value;
+public:
+    Operand() = default;
 
-    explicit ConstantOperand(T value): value(value) {}
-    std::string toString() const override {
-        return '#' + std::to_string(value);
+    static Operand temp(uint32_t id) {
+        return Operand(Kind::TEMP, id);
     }
-};
 
-struct PointerOperand: public TacOperand {
-    std::string name;
-    std::string toString() const override {
-        return name;
+    static Operand variable(uint32_t id) {
+        return Operand(Kind::VARIABLE, id);
     }
-};
-
-
-// three address code
-struct Tac {
-    virtual ~Tac() = default;
-    virtual std::string toString() const = 0;
-};
 
-
-struct LabelTac final: public Tac {
-    int no;
-
-    explicit LabelTac(int number): no(number) {}
-    std::string toString() const override {
-        return "LABEL label" + std::to_string(no) + " :";
+    static Operand constant(uint32_t index) {
+        return Operand(Kind::CONSTANT, index);
     }
-};
-
-struct FuncTac final: public Tac {
-    std::string name;
 
-    explicit FuncTac(std::string name): name(std::move(name)) {}
-    std::string toString() const {
-        return "FUNCTION " + name + " :";
+    static Operand label(uint32_t no) {
+        return Operand(Kind::LABEL, no);
     }
-};
-
-struct AssignTac final: public Tac {
-    std::shared_ptr<TacOperand> left, right;
 
-    AssignTac(std::shared_ptr<TacOperand> left, std::shared_ptr<TacOperand> right):
-        left(std::move(left)), right(std::move(right)) {}
-    std::string toString() const override {
-        return left->toString() + " := " + right->toString();
+    static Operand function(Ident name) {
+        return Operand(Kind::FUNCTION, name.value());
     }
-};
 
-struct ArithTac: public Tac {
-    std::shared_ptr<TacOperand> left, r1, r2;
-    virtual char opChar() const = 0;
-
-    ArithTac(std::shared_ptr<TacOperand> left, std::shared_ptr<TacOperand> r1, std::shared_ptr<TacOperand> r2):
-        left(std::move(left)), r1(std::move(r1)), r2(std::move(r2)) {}
-    std::string toString() const override {
-        return left->toString() + " := " + r1->toString() + " " + opChar() + " " + r2->toString();
+    Kind kind() const {
+        return static_cast<Kind>(bits >> VALUE_BITS);
     }
-};
 
-struct AddTac final: public ArithTac {
-    AddTac(std::shared_ptr<TacOperand> left, std::shared_ptr<TacOperand> r1, std::shared_ptr<TacOperand> r2):
-        ArithTac(std::move(left), std::move(r1), std::move(r2)) {}
-    char opChar() const override {
-        return '+';
+    uint32_t value() const {
+        return bits & VALUE_MASK;
     }
-};
 
-struct SubTac final: public ArithTac {
-    SubTac(std::shared_ptr<TacOperand> left, std::shared_ptr<TacOperand> r1, std::shared_ptr<TacOperand> r2):
-        ArithTac(std::move(left), std::move(r1), std::move(r2)) {}
-    char opChar() const override {
-        return '-';
+    Ident name() const {
+        return Ident::fromValue(value());
     }
-};
 
-struct MulTac final: public ArithTac {
-    MulTac(std::shared_ptr<TacOperand> left, std::shared_ptr<TacOperand> r1, std::shared_ptr<TacOperand> r2):
-        ArithTac(std::move(left), std::move(r1), std::move(r2)) {}
-    char opChar() const override {
-        return '*';
+    bool isPlace() const {
+        return kind() == Kind::TEMP || kind() == Kind::VARIABLE;
     }
-};
 
-struct DivTac final: public ArithTac {
-    DivTac(std::shared_ptr<TacOperand> left, std::shared_ptr<TacOperand> r1, std::shared_ptr<TacOperand> r2):
-        ArithTac(std::move(left), std::move(r1), std::move(r2)) {}
-    char opChar() const override {
-        return '/';
+    // an operand of the same kind with another number
+    Operand withValue(uint32_t value) const {
+        return Operand(kind(), value);
     }
-};
 
-struct AddrTac final: public Tac {
-    std::shared_ptr<TacOperand> left, right;
-    std::string toString() const override {
-        return left->toString() + " := &" + right->toString();
+    bool operator==(Operand other) const {
+        return bits == other.bits;
     }
-};
 
-struct FetchTac final: public Tac {
-    std::shared_ptr<TacOperand> left, raddr;
-    std::string toString() const override {
-        return left->toString() + " := *" + raddr->toString();
+    bool operator!=(Operand other) const {
+        return bits != other.bits;
     }
 };
 
-struct DerefTac final: public Tac {
-    std::shared_ptr<TacOperand> laddr, right;
-    std::string toString() const override {
-        return '*' + laddr->toString() + " := " + right->toString();
-    }
-};
 
-struct GotoTac final: public Tac {
-    int labelNo;
+struct Constant {
+    enum class Type: uint8_t { INT, CHAR, FLOAT } type;
+    union {
+        int32_t intVal;     // also holds characters
+        float floatVal;
+    };
 
-    explicit GotoTac(int labelNo): labelNo(labelNo) {}
-    std::string toString() const override {
-        return "GOTO label" + std::to_string(labelNo);
+    static Constant ofInt(int32_t value) {
+        Constant constant {};
+        constant.type = Type::INT;
+        constant.intVal = value;
+        return constant;
     }
-};
-
-struct IfGotoTac: public Tac {
-    std::shared_ptr<TacOperand> c1, c2;
-    int labelNo;
-    virtual std::string relopStr() const = 0;
 
-    IfGotoTac(std::shared_ptr<TacOperand> c1, std::shared_ptr<TacOperand> c2, int labelNo):
-        c1(std::move(c1)), c2(std::move(c2)), labelNo(labelNo) {}
-    std::string toString() const override {
-        return "IF " + c1->toString() + " " + relopStr() + " " + c2->toString() + " GOTO label" + std::to_string(labelNo);
+    static Constant ofChar(char value) {
+        Constant constant {};
+        constant.type = Type::CHAR;
+        constant.intVal = value;
+        return constant;
     }
-};
 
-struct IfLtGotoTac final: public IfGotoTac {
-    IfLtGotoTac(std::shared_ptr<TacOperand> c1, std::shared_ptr<TacOperand> c2, int labelNo):
-        IfGotoTac(std::move(c1), std::move(c2), labelNo) {}
-    std::string relopStr() const override {
-        return "<";
+    static Constant ofFloat(float value) {
+        Constant constant {};
+        constant.type = Type::FLOAT;
+        constant.floatVal = value;
+        return constant;
     }
-};
 
-struct IfLeGotoTac final: public IfGotoTac {
-    IfLeGotoTac(std::shared_ptr<TacOperand> c1, std::shared_ptr<TacOperand> c2, int labelNo):
-        IfGotoTac(std::move(c1), std::move(c2), labelNo) {}
-    std::string relopStr() const override {
-        return "<=";
+    uint64_t key() const {
+        uint32_t raw;
+        std::memcpy(&raw, &intVal, sizeof(raw));
+        return static_cast<uint64_t>(type) << 32 | raw;
     }
 };
 
-struct IfGtGotoTac final: public IfGotoTac {
-    IfGtGotoTac(std::shared_ptr<TacOperand> c1, std::shared_ptr<TacOperand> c2, int labelNo):
-        IfGotoTac(std::move(c1), std::move(c2), labelNo) {}
-    std::string relopStr() const override {
-        return ">";
-    }
-};
 
-struct IfGeGotoTac final: public IfGotoTac {
-    IfGeGotoTac(std::shared_ptr<TacOperand> c1, std::shared_ptr<TacOperand> c2, int labelNo):
-        IfGotoTac(std::move(c1), std::move(c2), labelNo) {}
-    std::string relopStr() const override {
-        return ">=";
-    }
+enum class Opcode: uint8_t {
+    LABEL, FUNCTION,
+    ASSIGN, ADD, SUB, MUL, DIV,
+    ADDR, FETCH, DEREF,
+    GOTO, IF_LT, IF_LE, IF_GT, IF_GE, IF_NE, IF_EQ,
+    RETURN, DEC, PARAM, ARG, CALL, READ, WRITE,
 };
 
-struct IfNeGotoTac final: public IfGotoTac {
-    IfNeGotoTac(std::shared_ptr<TacOperand> c1, std::shared_ptr<TacOperand> c2, int labelNo):
-        IfGotoTac(std::move(c1), std::move(c2), labelNo) {}
-    std::string relopStr() const override {
-        return "!=";
-    }
-};
-
-struct IfEqGotoTac final: public IfGotoTac {
-    IfEqGotoTac(std::shared_ptr<TacOperand> c1, std::shared_ptr<TacOperand> c2, int labelNo):
-        IfGotoTac(std::move(c1), std::move(c2), labelNo) {}
-    std::string relopStr() const override {
-        return "==";
-    }
+/**
+ * Three address code, as `result := arg1 op arg2'.
+ * Labels, jump targets, defined functions, and places written by PARAM, READ and DEC
+ * are kept in `result'; RETURN, ARG and WRITE read `arg1', and CALL names the callee in `arg1'.
+ * The size of DEC is an integer constant in `arg1'.
+ */
+struct Tac {
+    Opcode op;
+    Operand result, arg1, arg2;
 };
 
-struct ReturnTac final: public Tac {
-    std::shared_ptr<TacOperand> var;
+static_assert(sizeof(Tac) == 16, "instructions are expected to be packed into 16 bytes");
 
-    explicit ReturnTac(std::shared_ptr<TacOperand> var): var(std::move(var)) {}
-    std::string toString() const override {
-        return "RETURN " + var->toString();
+// whether the instruction assigns a value to the place in `result'
+inline bool writesResult(Opcode op) {
+    switch (op) {
+    case Opcode::ASSIGN: case Opcode::ADD: case Opcode::SUB: case Opcode::MUL: case Opcode::DIV:
+    case Opcode::ADDR: case Opcode::FETCH: case Opcode::PARAM: case Opcode::CALL: case Opcode::READ:
+        return true;
+    default:
+        return false;
     }
-};
+}
 
-struct DecSpaceTac final: public Tac {
-    std::shared_ptr<TacOperand> var;
-    int size;
-    std::string toString() const override {
-        return "DEC " + var->toString() + ' ' + std::to_string(size);
-    }
-};
+inline bool isBranch(Opcode op) {
+    return op >= Opcode::IF_LT && op <= Opcode::IF_EQ;
+}
 
-struct ParamTac final: public Tac {
-    std::shared_ptr<TacOperand> p;
+// whether the instruction may jump to the label in `result'
+inline bool isJump(Opcode op) {
+    return op == Opcode::GOTO || isBranch(op);
+}
 
-    explicit ParamTac(std::shared_ptr<TacOperand> p): p(std::move(p)) {}
-    std::string toString() const override {
-        return "PARAM " + p->toString();
+// the conditional branch taken exactly when the given one is not
+inline Opcode negateBranch(Opcode branch) {
+    switch (branch) {
+    case Opcode::IF_LT: return Opcode::IF_GE;
+    case Opcode::IF_LE: return Opcode::IF_GT;
+    case Opcode::IF_GT: return Opcode::IF_LE;
+    case Opcode::IF_GE: return Opcode::IF_LT;
+    case Opcode::IF_NE: return Opcode::IF_EQ;
+    case Opcode::IF_EQ: return Opcode::IF_NE;
+    default: throw std::invalid_argument("not a conditional branch");
     }
-};
-
-struct ArgTac final: public Tac {
-    std::shared_ptr<TacOperand> var;
+}
 
-    explicit ArgTac(std::shared_ptr<TacOperand> var): var(std::move(var)) {}
-    std::string toString() const override {
-        return "ARG " + var->toString();
+/**
+ * Calls `visit(operand, isAddress)' on every operand whose value the instruction reads,
+ * where `isAddress' tells the addresses of FETCH and DEREF from plain values.
+ * The place whose address is taken by ADDR is not read.
+ */
+template <typename T, typename Visitor>
+inline void forEachUse(T& tac, Visitor&& visit) {
+    switch (tac.op) {
+    case Opcode::ADD: case Opcode::SUB: case Opcode::MUL: case Opcode::DIV:
+    case Opcode::IF_LT: case Opcode::IF_LE: case Opcode::IF_GT: case Opcode::IF_GE: case Opcode::IF_NE: case Opcode::IF_EQ:
+        visit(tac.arg1, false);
+        visit(tac.arg2, false);
+        break;
+    case Opcode::ASSIGN: case Opcode::RETURN: case Opcode::ARG: case Opcode::WRITE:
+        visit(tac.arg1, false);
+        break;
+    case Opcode::FETCH:
+        visit(tac.arg1, true);
+        break;
+    case Opcode::DEREF:
+        visit(tac.result, true);
+        visit(tac.arg1, false);
+        break;
+    default:
+        break;
     }
-};
-
-struct CallTac final: public Tac {
-    std::shared_ptr<TacOperand> ret;
-    std::string funcName;
+}
 
-    CallTac(std::shared_ptr<TacOperand> ret, std::string  funcName):
-        ret(std::move(ret)), funcName(std::move(funcName)) {}
-    std::string toString() const override {
-        return ret->toString() + " := CALL " + funcName;
-    }
-};
 
-struct ReadTac final: public Tac {
-    std::shared_ptr<TacOperand> p;
+// instructions of a program, in order, and the constants they refer to
+struct Code {
+    std::vector<Tac> tacs;
+    std::vector<Constant> constants;
+    std::unordered_map<uint64_t, uint32_t> constantIds;
 
-    explicit ReadTac(std::shared_ptr<TacOperand> p): p(std::move(p)) {}
-    std::string toString() const override {
-        return "READ " + p->toString();
+    // equal constants share an entry of the pool
+    Operand constant(Constant value) {
+        auto inserted = constantIds.emplace(value.key(), constants.size());
+        if (inserted.second) constants.push_back(value);
+        return Operand::constant(inserted.first->second);
     }
-};
-
-struct WriteTac final: public Tac {
-    std::shared_ptr<TacOperand> p;
 
-    explicit WriteTac(std::shared_ptr<TacOperand> p): p(std::move(p)) {}
-    std::string toString() const override {
-        return "WRITE " + p->toString();
+    const Constant& constantOf(Operand operand) const {
+        return constants[operand.value()];
     }
-};
 
+    size_t size() const {
+        return tacs.size();
+    }
 
-template<typename T, typename... Args, typename std::enable_if<std::is_base_of<TacOperand, T>::value>::type* = nullptr>
-inline std::shared_ptr<TacOperand> makeTacOp(Args... args) {
-    return std::shared_ptr<TacOperand>(new T(args...));
-}
+    void print(std::ostream& out, const Tac& tac) const;
+};
 
 } // namespace ir
 
 
-inline std::ostream& operator<<(std::ostream& out, const ir::Tac& tac) {
-    return out << tac.toString();
-}
+// one instruction per line, in the text form of the IR
+std::ostream& operator<<(std::ostream& out, const ir::Code& code);
 
 #endif // TAC_HPP
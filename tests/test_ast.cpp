@@ -113,3 +113,31 @@ TEST_CASE("ast can be constructed", "[ast-program]") {
         }
     }
 }
+
+
+#ifdef SPLC_AST_ARENA
+TEST_CASE("parsed nodes live in an arena owned by the program", "[ast-arena]") {
+    const char * src =
+        "int main() {"
+        "  int a = 1;"
+        "  while (a < 10) a = a + 1;"
+        "  return a;"
+        "}";
+    unique_ptr<ast::Program> ast(parseStr(src));
+    REQUIRE(ast != nullptr);
+    REQUIRE(ast->storage != nullptr);
+    CHECK(ast->arena == nullptr);
+
+    auto func = dynamic_cast<const FunDef*>(ast->extDefs[0]);
+    REQUIRE(func != nullptr);
+    CHECK(func->arena == ast->storage.get());
+    CHECK(func->body->arena == ast->storage.get());
+    CHECK(ast->storage->size() > 10);
+
+    SECTION("nodes built outside of parsing stay on the heap") {
+        auto exp = make_unique<BinaryExp>(new IdExp("a"), Operator::PLUS, new LiteralExp(1));
+        CHECK(exp->arena == nullptr);
+        CHECK(exp->left->arena == nullptr);
+    }
+}
+#endif
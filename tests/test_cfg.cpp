@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "cfg.hpp"
+#include "gen_tac.hpp"
+#include "ir_reader.hpp"
+#include "liveness.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+#include "semantic.hpp"
+
+using namespace std;
+using Blocks = vector<uint32_t>;
+
+
+static ir::Code read(const char *text) {
+    istringstream in(text);
+    return ir::readIr(in);
+}
+
+
+TEST_CASE("functions are split into basic blocks", "[cfg]") {
+    auto code = read(
+        "FUNCTION main :\n"
+        "t1 := #0\n"
+        "LABEL label1 :\n"
+        "IF t1 >= #10 GOTO label4\n"
+        "t2 := #0\n"
+        "LABEL label2 :\n"
+        "IF t2 >= t1 GOTO label3\n"
+        "t2 := t2 + #1\n"
+        "GOTO label2\n"
+        "LABEL label3 :\n"
+        "t1 := t1 + #1\n"
+        "GOTO label1\n"
+        "WRITE #0\n"
+        "LABEL label4 :\n"
+        "ARG t1\n"
+        "t3 := CALL main\n"
+        "WRITE t3\n"
+        "RETURN t1\n"
+    );
+    auto graphs = ir::Cfg::ofFunctions(code);
+    REQUIRE(graphs.size() == 1);
+    auto& cfg = graphs[0];
+    REQUIRE(cfg.size() == 8);
+    CHECK(cfg.functionName() == "main");
+
+    SECTION("blocks are linked by jumps and fall-through") {
+        CHECK(cfg[0].first == 0);
+        CHECK(cfg[0].last == 2);
+        CHECK(cfg[7].first == 13);
+        CHECK(cfg[7].last == code.size());
+        const Blocks succs[] = { { 1 }, { 7, 2 }, { 3 }, { 5, 4 }, { 3 }, { 1 }, { 7 }, {} };
+        const Blocks preds[] = { {}, { 0, 5 }, { 1 }, { 2, 4 }, { 3 }, { 3 }, {}, { 1, 6 } };
+        for (uint32_t b = 0; b < cfg.size(); ++b) {
+            INFO("block " << b);
+            CHECK(cfg[b].succs == succs[b]);
+            CHECK(cfg[b].preds == preds[b]);
+        }
+        CHECK(cfg.blockOf(0) == 0);
+        CHECK(cfg.blockOf(9) == 5);
+        CHECK(cfg.blockOf(code.size()) == ir::Cfg::NO_BLOCK);
+    }
+
+    SECTION("dominators") {
+        const uint32_t idoms[] = { 0, 0, 1, 2, 3, 3, ir::Cfg::NO_BLOCK, 1 };
+        for (uint32_t b = 0; b < cfg.size(); ++b) {
+            INFO("block " << b);
+            CHECK(cfg[b].idom == idoms[b]);
+        }
+        CHECK_FALSE(cfg.reachable(6));
+        CHECK(cfg.dominates(1, 5));
+        CHECK(cfg.dominates(3, 3));
+        CHECK_FALSE(cfg.dominates(2, 7));
+        CHECK_FALSE(cfg.dominates(6, 7));
+        auto& order = cfg.reversePostorder();
+        CHECK(order.size() == 7);
+        CHECK(order.front() == 0);
+        CHECK(find(order.begin(), order.end(), 6) == order.end());
+    }
+
+    SECTION("natural loops are nested") {
+        REQUIRE(cfg.loops().size() == 2);
+        auto& outer = cfg.loops()[0], & inner = cfg.loops()[1];
+        CHECK(outer.header == 1);
+        CHECK(outer.blocks == Blocks { 1, 2, 3, 4, 5 });
+        CHECK(outer.latches == Blocks { 5 });
+        CHECK(outer.parent == ir::Cfg::NO_LOOP);
+        CHECK(inner.header == 3);
+        CHECK(inner.blocks == Blocks { 3, 4 });
+        CHECK(inner.parent == 0);
+    }
+
+    SECTION("graphs are drawn for Graphviz") {
+        ostringstream dot;
+        cfg.printDot(dot);
+        string text = dot.str();
+        CHECK(text.rfind("digraph \"main\" {\n", 0) == 0);
+        CHECK(text.find("\tb6 [label=\"WRITE #0\\l\", style=dashed];\n") != string::npos);
+        CHECK(text.find("\tb4 [label=\"t2 := t2 + #1\\lGOTO label2\\l\"];\n") != string::npos);
+        CHECK(text.find("\tb5 -> b1 [style=bold];\n") != string::npos);
+        CHECK(text.find("\tb1 -> b2;\n") != string::npos);
+    }
+
+    SECTION("places are live until their last reads") {
+        using Live = vector<bool>;
+        ir::Liveness liveness(cfg, ir::untrackedPlaces(code));
+        REQUIRE(liveness.places().size() == 3);
+        CHECK(liveness.indexOf(ir::Operand::temp(2)) == 1);
+        CHECK(liveness.indexOf(code.tacs[1].arg1) == ir::Liveness::NO_INDEX);
+        CHECK(liveness.liveAtEntry(0) == Live { false, false, false });
+        CHECK(liveness.liveAtExit(0) == Live { true, false, false });
+        CHECK(liveness.liveAtEntry(3) == Live { true, true, false });
+        CHECK(liveness.liveAtExit(1) == Live { true, false, false });
+        CHECK(liveness.liveAtEntry(6) == Live { false, false, false });
+        CHECK(liveness.liveAtExit(7) == Live { false, false, false });
+
+        vector<Live> after;
+        liveness.walkBackward(7, [&](size_t, const Live& live) { after.push_back(live); });
+        REQUIRE(after.size() == 5);
+        CHECK(after[0] == Live { false, false, false });
+        CHECK(after[1] == Live { true, false, false });
+        CHECK(after[2] == Live { true, false, true });
+        CHECK(after[4] == Live { true, false, false });
+    }
+}
+
+
+TEST_CASE("control-flow graphs cover generated functions", "[cfg]") {
+    const filesystem::path corpus(SPLC_CORPUS_DIR);
+    for (auto name: { "../sample/test01.spl", "../sample/test02.spl", "test_4_r01.spl", "test_4_r03.spl" }) {
+        INFO(name);
+        FILE *file = fopen((corpus / name).c_str(), "r");
+        REQUIRE(file != nullptr);
+        unique_ptr<ast::Program> program(parseFile(file));
+        fclose(file);
+        REQUIRE(program != nullptr);
+        REQUIRE(smt::analyzeSemantic(program.get()).empty());
+        ir::TacGenerator generator(program.get());
+        auto& code = generator.getTac();
+
+        size_t covered = 0;
+        for (auto& cfg: ir::Cfg::ofFunctions(code)) {
+            for (uint32_t b = 0; b < cfg.size(); ++b) {
+                covered += cfg[b].last - cfg[b].first;
+                CHECK((b == 0 || cfg[b].first == cfg[b - 1].last));
+                for (auto succ: cfg[b].succs) {
+                    auto& preds = cfg[succ].preds;
+                    CHECK(find(preds.begin(), preds.end(), b) != preds.end());
+                }
+                if (cfg.reachable(b)) CHECK(cfg.dominates(0, b));
+            }
+        }
+        CHECK(covered == code.size());
+    }
+}
+
+
+TEST_CASE("jumps to undefined labels are rejected", "[cfg]") {
+    auto code = read("FUNCTION main :\nGOTO label3\n");
+    CHECK_THROWS_WITH(ir::Cfg(code, 0, code.size()), "jump to undefined label3 in function main");
+}
@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "gen_tac.hpp"
+#include "ir_writer.hpp"
+#include "parser.hpp"
+#include "semantic.hpp"
+
+using namespace std;
+
+
+static string generate(ast::Program *program, unsigned workers) {
+    auto generator = make_unique<ir::TacGenerator>(program, workers);
+    ostringstream out;
+    out << generator->getTac();
+    return out.str();
+}
+
+
+TEST_CASE("functions translated in parallel are numbered as if translated in order", "[gen-tac]") {
+    const char *prelude =
+        "int g;\n"
+        "int first(int a) {\n"
+        "    int b = a + g;\n"
+        "    while (b < 10) { b = b + 1; }\n"
+        "    return b;\n"
+        "}\n";
+    const char *function =
+        "int f(int n) {\n"
+        "    int i = 0, s = 0;\n"
+        "    while (i < n && g != 0) {\n"
+        "        if (i > 3) s = s + i; else s = s - first(i);\n"
+        "        i = i + 1;\n"
+        "    }\n"
+        "    g = s;\n"
+        "    return g;\n"
+        "}\n";
+
+    string src = prelude;
+    for (int i = 0; i < 200; ++i) {
+        string def = function;
+        def.replace(def.find("f("), 1, "f" + to_string(i));
+        src += def;
+    }
+    unique_ptr<ast::Program> program(parseStr(src.c_str()));
+    REQUIRE(program != nullptr);
+    REQUIRE(smt::analyzeSemantic(program.get()).empty());
+
+    string serial = generate(program.get(), 1);
+    CHECK(serial.find("FUNCTION f199 :") != string::npos);
+    CHECK(generate(program.get(), 4) == serial);
+    CHECK(generate(program.get(), 16) == serial);
+}
+
+
+TEST_CASE("a global variable keeps the number of its first use", "[gen-tac]") {
+    unique_ptr<ast::Program> program(parseStr(
+        "int g;\n"
+        "int f1() { return g; }\n"
+        "int f2(int a) { return a + g; }\n"
+    ));
+    REQUIRE(program != nullptr);
+    REQUIRE(smt::analyzeSemantic(program.get()).empty());
+    CHECK(generate(program.get(), 2) ==
+        "FUNCTION f1 :\n"
+        "t1 := t2\n"
+        "RETURN t1\n"
+        "FUNCTION f2 :\n"
+        "PARAM t3\n"
+        "t5 := t3\n"
+        "t6 := t2\n"
+        "t4 := t5 + t6\n"
+        "RETURN t4\n"
+    );
+}
+
+
+TEST_CASE("instructions refer to pooled constants", "[gen-tac]") {
+    unique_ptr<ast::Program> program(parseStr(
+        "int f(int a) {\n"
+        "    int b = 3 + a;\n"
+        "    write(b - 3);\n"
+        "    return -b;\n"
+        "}\n"
+    ));
+    REQUIRE(program != nullptr);
+    REQUIRE(smt::analyzeSemantic(program.get()).empty());
+    auto generator = make_unique<ir::TacGenerator>(program.get(), 1);
+    auto& code = generator->getTac();
+    CHECK(code.constants.size() == 2);  // 3, and 0 for negation
+    CHECK(code.size() == 13);
+    ostringstream out;
+    out << code;
+    CHECK(out.str() ==
+        "FUNCTION f :\n"
+        "PARAM t1\n"
+        "t4 := #3\n"
+        "t5 := t1\n"
+        "t3 := t4 + t5\n"
+        "t2 := t3\n"
+        "t8 := t2\n"
+        "t9 := #3\n"
+        "t7 := t8 - t9\n"
+        "WRITE t7\n"
+        "t11 := t2\n"
+        "t10 := #0 - t11\n"
+        "RETURN t10\n"
+    );
+}
+
+
+static string writeIr(const ir::Code& code) {
+    ostringstream out;
+    ir::IrWriter(out) << code;
+    return out.str();
+}
+
+
+TEST_CASE("the IR writer prints the text form of every instruction", "[gen-tac]") {
+    SECTION("sources of the corpus") {
+        vector<string> paths;
+        for (auto dir: { filesystem::path(SPLC_CORPUS_DIR), filesystem::path(SPLC_CORPUS_DIR) / "../sample" }) {
+            for (auto& entry: filesystem::directory_iterator(dir)) {
+                if (entry.path().extension() == ".spl") paths.push_back(entry.path().string());
+            }
+        }
+        sort(paths.begin(), paths.end());
+        size_t translated = 0;
+        for (auto& path: paths) {
+            FILE *file = fopen(path.c_str(), "r");
+            REQUIRE(file != nullptr);
+            unique_ptr<ast::Program> program(parseFile(file));
+            fclose(file);
+            if (program == nullptr || !smt::analyzeSemantic(program.get()).empty()) continue;
+            unique_ptr<ir::TacGenerator> generator;
+            try {
+                generator = make_unique<ir::TacGenerator>(program.get());
+            } catch (const exception&) {
+                continue;   // structures and arrays are not translated yet
+            }
+            ostringstream expected;
+            expected << generator->getTac();
+            INFO(path);
+            CHECK(writeIr(generator->getTac()) == expected.str());
+            ++translated;
+        }
+        CHECK(translated >= 5);
+    }
+
+    SECTION("constants, long names, and code beyond the buffer") {
+        ir::Code code;
+        string longName(100000, 'f');
+        code.tacs.push_back({ ir::Opcode::FUNCTION, ir::Operand::function(longName) });
+        for (int i = 0; i < 20000; ++i) {
+            code.tacs.push_back({ ir::Opcode::ASSIGN, ir::Operand::temp(i), code.constant(ir::Constant::ofInt(-i)) });
+        }
+        code.tacs.push_back({ ir::Opcode::ASSIGN, ir::Operand::temp(1), code.constant(ir::Constant::ofChar('a')) });
+        code.tacs.push_back({ ir::Opcode::ASSIGN, ir::Operand::temp(2), code.constant(ir::Constant::ofFloat(1.5)) });
+        code.tacs.push_back({ ir::Opcode::DEC, ir::Operand::variable(3), code.constant(ir::Constant::ofInt(32)) });
+        code.tacs.push_back({ ir::Opcode::CALL, ir::Operand::temp(4), ir::Operand::function(longName) });
+
+        ostringstream expected;
+        expected << code;
+        string text = writeIr(code);
+        CHECK(text == expected.str());
+        CHECK(text.find("\nt1 := #97\nt2 := #1.500000\nDEC t3 32\n") != string::npos);
+    }
+}
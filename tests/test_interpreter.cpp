@@ -0,0 +1,120 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include "catch.hpp"
+#include "gen_tac.hpp"
+#include "interpreter.hpp"
+#include "ir_reader.hpp"
+#include "ir_writer.hpp"
+#include "parser.hpp"
+#include "semantic.hpp"
+
+using namespace std;
+
+
+static ir::Code compile(const string& path) {
+    FILE *file = fopen(path.c_str(), "r");
+    REQUIRE(file != nullptr);
+    unique_ptr<ast::Program> program(parseFile(file));
+    fclose(file);
+    REQUIRE(program != nullptr);
+    REQUIRE(smt::analyzeSemantic(program.get()).empty());
+    // the interpreter takes what splc writes
+    ostringstream text;
+    ir::IrWriter(text) << ir::TacGenerator(program.get()).getTac();
+    istringstream in(text.str());
+    return ir::readIr(in);
+}
+
+static ir::Code load(const string& path) {
+    ifstream in(path);
+    REQUIRE(in);
+    return ir::readIr(in);
+}
+
+static string run(const ir::Code& code, const string& input) {
+    ir::Interpreter interpreter(code);
+    interpreter.setStepLimit(10000000);
+    istringstream in(input);
+    ostringstream out;
+    interpreter.run(in, out);
+    return out.str();
+}
+
+
+TEST_CASE("compiled programs behave like the reference IR", "[interpreter]") {
+    const filesystem::path corpus(SPLC_CORPUS_DIR);
+    const pair<filesystem::path, vector<string>> programs[] = {
+        { corpus / "../sample/test01", { "5", "0", "-3" } },
+        { corpus / "../sample/test02", { "1", "2", "7" } },
+        { corpus / "test_4_r01", { "" } },
+        { corpus / "test_4_r02", { "0", "1", "5", "12" } },
+        { corpus / "test_4_r03", { "" } },
+    };
+    for (auto& program: programs) {
+        auto compiled = compile(program.first.string() + ".spl");
+        auto reference = load(program.first.string() + ".ir");
+        for (auto& input: program.second) {
+            INFO(program.first << " with input " << input);
+            string output = run(reference, input);
+            CHECK_FALSE(output.empty());
+            CHECK(run(compiled, input) == output);
+        }
+    }
+}
+
+
+TEST_CASE("the interpreter runs every form of instruction", "[interpreter]") {
+    SECTION("arrays are addressed in bytes") {
+        CHECK(run(load(string(SPLC_CORPUS_DIR) + "/../sample/test03.ir"), "") == "3\n");
+        CHECK(run(load(string(SPLC_CORPUS_DIR) + "/../sample/test04.ir"), "") == "1\n3\n");
+    }
+
+    SECTION("instructions are counted") {
+        istringstream text(
+            "FUNCTION main :\n"
+            "t1 := #0\n"
+            "LABEL label1 :\n"
+            "IF t1 >= #10 GOTO label2\n"
+            "t1 := t1 + #1\n"
+            "GOTO label1\n"
+            "LABEL label2 :\n"
+            "WRITE t1\n"
+            "RETURN #0\n"
+        );
+        ir::Interpreter interpreter(ir::readIr(text));
+        istringstream in;
+        ostringstream out;
+        CHECK(interpreter.run(in, out) == 0);
+        CHECK(out.str() == "10\n");
+        CHECK(interpreter.executed() == 1 + 11 + 20 + 2);
+
+        interpreter.setStepLimit(20);
+        CHECK_THROWS_WITH(interpreter.run(in, out), "step limit exceeded");
+        CHECK(interpreter.executed() == 21);
+    }
+
+    SECTION("runtime errors are reported") {
+        istringstream text(
+            "FUNCTION main :\n"
+            "READ t1\n"
+            "t2 := #10 / t1\n"
+            "WRITE t2\n"
+            "RETURN t2\n"
+        );
+        auto code = ir::readIr(text);
+        CHECK(run(code, "3") == "3\n");
+        CHECK_THROWS_WITH(run(code, "0"), "division by zero");
+        CHECK_THROWS_WITH(run(code, ""), "no more input to read");
+    }
+
+    SECTION("undefined labels and functions are rejected before running") {
+        istringstream jump("FUNCTION main :\nGOTO label9\n");
+        CHECK_THROWS_AS(ir::Interpreter(ir::readIr(jump)), runtime_error);
+        istringstream call("FUNCTION main :\nt1 := CALL f\nRETURN t1\n");
+        CHECK_THROWS_AS(ir::Interpreter(ir::readIr(call)), runtime_error);
+    }
+}
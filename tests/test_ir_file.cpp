@@ -0,0 +1,93 @@
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include "catch.hpp"
+#include "gen_tac.hpp"
+#include "ir_binary.hpp"
+#include "ir_reader.hpp"
+#include "ir_writer.hpp"
+#include "parser.hpp"
+#include "semantic.hpp"
+
+using namespace std;
+
+
+static string toText(const ir::Code& code) {
+    ostringstream out;
+    ir::IrWriter(out) << code;
+    return out.str();
+}
+
+static string tempPath(const string& name) {
+    return (filesystem::temp_directory_path() / name).string();
+}
+
+static void writeFile(const string& path, const string& contents) {
+    ofstream out(path, ios::binary);
+    out << contents;
+}
+
+
+TEST_CASE("IR converts between the text and the binary form", "[ir-file]") {
+    unique_ptr<ast::Program> program(parseStr(
+        "int sum(int n) {\n"
+        "    int i = 0, s = 0;\n"
+        "    while (i < n) { s = s + i * 2; i = i + 1; }\n"
+        "    return s;\n"
+        "}\n"
+        "int main() {\n"
+        "    int n = read();\n"
+        "    if (n >= 0 && n != 7) write(sum(n)); else write(-1);\n"
+        "    return 0;\n"
+        "}\n"
+    ));
+    REQUIRE(program != nullptr);
+    REQUIRE(smt::analyzeSemantic(program.get()).empty());
+    auto generator = make_unique<ir::TacGenerator>(program.get());
+    string text = toText(generator->getTac());
+
+    SECTION("text is read back into the same instructions") {
+        istringstream in(text);
+        CHECK(toText(ir::readIr(in)) == text);
+    }
+
+    SECTION("a binary file is used in place") {
+        string path = tempPath("splc_test_ir_file.irb");
+        ostringstream binary;
+        ir::writeBinaryIr(binary, generator->getTac());
+        writeFile(path, binary.str());
+        {
+            ir::MappedIr mapped(path);
+            REQUIRE(mapped.size() == generator->getTac().size());
+            CHECK(mapped[0].op == ir::Opcode::FUNCTION);
+            CHECK(mapped.nameOf(mapped[0].result) == "sum");
+            REQUIRE(mapped.functionCount() == 2);
+            auto& mainEntry = mapped.functions()[1];
+            CHECK(mapped.nameAt(mainEntry.name) == "main");
+            CHECK(mainEntry.first + mainEntry.count == mapped.size());
+            CHECK(mapped.functions()[0].count == mainEntry.first);
+            CHECK(toText(mapped.toCode()) == text);
+        }
+        filesystem::remove(path);
+    }
+
+    SECTION("broken files are rejected") {
+        string path = tempPath("splc_test_ir_file_broken.irb");
+        ostringstream binary;
+        ir::writeBinaryIr(binary, generator->getTac());
+        string truncated = binary.str().substr(0, binary.str().size() / 2);
+        writeFile(path, truncated);
+        CHECK_THROWS_AS(ir::MappedIr(path), runtime_error);
+        writeFile(path, text);
+        CHECK_THROWS_AS(ir::MappedIr(path), runtime_error);
+        filesystem::remove(path);
+    }
+}
+
+
+TEST_CASE("malformed IR text is reported with its line", "[ir-file]") {
+    istringstream in("FUNCTION main :\nt1 := #1\nt2 := t1 % t1\n");
+    CHECK_THROWS_WITH(ir::readIr(in), "line 3: unknown operator %");
+}
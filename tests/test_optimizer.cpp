@@ -0,0 +1,747 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include "catch.hpp"
+#include "cfg.hpp"
+#include "gen_tac.hpp"
+#include "interpreter.hpp"
+#include "ir_reader.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+#include "semantic.hpp"
+
+using namespace std;
+
+
+static ir::Code generate(unique_ptr<ast::Program> program) {
+    REQUIRE(program != nullptr);
+    REQUIRE(smt::analyzeSemantic(program.get()).empty());
+    return ir::TacGenerator(program.get()).getTac();
+}
+
+static ir::Code compileFile(const string& path) {
+    FILE *file = fopen(path.c_str(), "r");
+    REQUIRE(file != nullptr);
+    unique_ptr<ast::Program> program(parseFile(file));
+    fclose(file);
+    return generate(move(program));
+}
+
+static ir::Code optimized(ir::Code code, int level = 1) {
+    ir::optimize(code, level);
+    return code;
+}
+
+// the passes of level 1, but with each temporary keeping a number of its own
+static void simplify(ir::Code& code) {
+    for (bool changed = true; changed;) {
+        changed = ir::foldConstants(code);
+        changed |= ir::numberValues(code);
+        changed |= ir::propagateCopies(code);
+        changed |= ir::simplifyBranches(code);
+        changed |= ir::eliminateDeadCode(code);
+    }
+}
+
+static string text(const ir::Code& code) {
+    ostringstream out;
+    out << code;
+    return out.str();
+}
+
+static string run(const ir::Code& code, const string& input) {
+    ir::Interpreter interpreter(code);
+    interpreter.setStepLimit(10000000);
+    istringstream in(input);
+    ostringstream out;
+    interpreter.run(in, out);
+    return out.str();
+}
+
+
+TEST_CASE("constants are propagated and folded", "[optimizer]") {
+    SECTION("known arithmetic and branches disappear") {
+        auto code = generate(unique_ptr<ast::Program>(parseStr(
+            "int main() {\n"
+            "    int a = 2 * 3;\n"
+            "    int b = a + 4;\n"
+            "    if (b > 5) write(b); else write(0);\n"
+            "    return -a;\n"
+            "}\n"
+        )));
+        auto folded = optimized(code);
+        string ir = text(folded);
+        INFO(ir);
+        CHECK(ir.find(" * ") == string::npos);
+        CHECK(ir.find(" - ") == string::npos);
+        CHECK(ir.find("IF ") == string::npos);
+        CHECK(ir.find("WRITE #10") != string::npos);
+        CHECK(ir.find("RETURN #-6") != string::npos);
+        CHECK(folded.size() <= code.size());
+        CHECK(run(folded, "") == run(code, ""));
+        CHECK(text(optimized(code, 0)) == text(code));
+    }
+
+    SECTION("places assigned in loops are only known up to the next label") {
+        auto code = optimized(generate(unique_ptr<ast::Program>(parseStr(
+            "int main() {\n"
+            "    int i = 0, s = 1;\n"
+            "    while (i < 10) { s = s * 2; i = i + 1; }\n"
+            "    write(s);\n"
+            "    return 0;\n"
+            "}\n"
+        ))));
+        string ir = text(code);
+        INFO(ir);
+        CHECK(ir.find("IF ") != string::npos);
+        CHECK(run(code, "") == "1024\n");
+    }
+
+    SECTION("failing operations are left to run time") {
+        auto code = optimized(generate(unique_ptr<ast::Program>(parseStr(
+            "int main() {\n"
+            "    int z = 0;\n"
+            "    write(7 / z);\n"
+            "    return 0;\n"
+            "}\n"
+        ))));
+        CHECK(text(code).find(" / ") != string::npos);
+        CHECK_THROWS_WITH(run(code, ""), "division by zero");
+    }
+
+    SECTION("places read before their assignment are still zero there") {
+        istringstream in(
+            "FUNCTION main :\n"
+            "v1 := #0\n"
+            "LABEL label1 :\n"
+            "IF v1 >= #2 GOTO label2\n"
+            "WRITE v2\n"
+            "v2 := #5\n"
+            "v1 := v1 + #1\n"
+            "GOTO label1\n"
+            "LABEL label2 :\n"
+            "RETURN #0\n"
+        );
+        auto code = ir::readIr(in);
+        CHECK(run(code, "") == "0\n5\n");
+        auto folded = code;
+        ir::foldConstants(folded);
+        CHECK(run(folded, "") == "0\n5\n");
+        for (int level: { 1, 2 }) CHECK(run(optimized(code, level), "") == "0\n5\n");
+
+        auto called = generate(unique_ptr<ast::Program>(parseStr(
+            "int five() {\n"
+            "    return 5;\n"
+            "}\n"
+            "int main() {\n"
+            "    int i = 0, x;\n"
+            "    while (i < 2) {\n"
+            "        if (x == 0) write(i);\n"
+            "        x = five();\n"
+            "        i = i + 1;\n"
+            "    }\n"
+            "    return 0;\n"
+            "}\n"
+        )));
+        CHECK(run(called, "") == "0\n");
+        for (int level: { 1, 2 }) CHECK(run(optimized(called, level), "") == "0\n");
+    }
+
+    SECTION("places whose address is taken are not tracked") {
+        ir::Code code;
+        code.tacs = {
+            { ir::Opcode::FUNCTION, ir::Operand::function(Ident("main")), {}, {} },
+            { ir::Opcode::ASSIGN, ir::Operand::temp(1), code.constant(ir::Constant::ofInt(1)), {} },
+            { ir::Opcode::ADDR, ir::Operand::temp(2), ir::Operand::temp(1), {} },
+            { ir::Opcode::DEREF, ir::Operand::temp(2), code.constant(ir::Constant::ofInt(5)), {} },
+            { ir::Opcode::ADD, ir::Operand::temp(2), ir::Operand::temp(1), code.constant(ir::Constant::ofInt(1)) },
+            { ir::Opcode::WRITE, {}, ir::Operand::temp(2), {} },
+            { ir::Opcode::RETURN, {}, code.constant(ir::Constant::ofInt(0)), {} },
+        };
+        auto folded = optimized(code);
+        CHECK(text(folded) == text(code));
+        CHECK(run(folded, "") == "6\n");
+    }
+}
+
+
+TEST_CASE("copies are propagated and coalesced", "[optimizer]") {
+    SECTION("temporaries holding copies are read from their sources") {
+        auto code = generate(unique_ptr<ast::Program>(parseStr(
+            "int main() {\n"
+            "    int a = read();\n"
+            "    int b = a;\n"
+            "    a = a + 1;\n"
+            "    write(b);\n"
+            "    write(a * b);\n"
+            "    return 0;\n"
+            "}\n"
+        )));
+        auto copied = optimized(code);
+        INFO(text(copied));
+        CHECK(copied.size() * 2 < code.size());
+        CHECK(run(copied, "4") == "4\n20\n");
+        CHECK(run(code, "4") == "4\n20\n");
+    }
+
+    SECTION("results are written right into the places they are copied to") {
+        auto code = optimized(generate(unique_ptr<ast::Program>(parseStr(
+            "int main() {\n"
+            "    int i = 0, s = 0;\n"
+            "    while (i < 10) { s = s + i * i; i = i + 1; }\n"
+            "    write(s);\n"
+            "    return 0;\n"
+            "}\n"
+        ))));
+        string ir = text(code);
+        INFO(ir);
+        size_t copies = 0;
+        for (auto& tac: code.tacs) {
+            if (tac.op == ir::Opcode::ASSIGN && tac.arg1.isPlace()) ++copies;
+        }
+        CHECK(copies == 0);
+        CHECK(run(code, "") == "285\n");
+    }
+}
+
+
+TEST_CASE("dead code and redundant labels are removed", "[optimizer]") {
+    istringstream in(
+        "FUNCTION main :\n"
+        "READ t1\n"
+        "IF t1 > #0 GOTO label3\n"
+        "IF t1 == #-1 GOTO label1\n"
+        "GOTO label2\n"
+        "WRITE #5\n"
+        "LABEL label1 :\n"
+        "LABEL label3 :\n"
+        "t2 := t1 * #2\n"
+        "t3 := t1 + #1\n"
+        "t4 := t1 / #0\n"
+        "WRITE t2\n"
+        "RETURN #0\n"
+        "LABEL label2 :\n"
+        "LABEL label4 :\n"
+        "RETURN t1\n"
+        "WRITE #7\n"
+        "LABEL label5 :\n"
+        "WRITE #8\n"
+        "FUNCTION unused :\n"
+        "RETURN #0\n"
+    );
+    auto code = ir::readIr(in);
+    CHECK(ir::eliminateDeadCode(code));
+    CHECK(text(code) ==
+        "FUNCTION main :\n"
+        "READ t1\n"
+        "IF t1 > #0 GOTO label1\n"
+        "IF t1 == #-1 GOTO label1\n"
+        "GOTO label2\n"
+        "LABEL label1 :\n"
+        "t2 := t1 * #2\n"
+        "t4 := t1 / #0\n"
+        "WRITE t2\n"
+        "RETURN #0\n"
+        "LABEL label2 :\n"
+        "RETURN t1\n"
+        "FUNCTION unused :\n"
+        "RETURN #0\n"
+    );
+    CHECK_FALSE(ir::eliminateDeadCode(code));
+}
+
+
+TEST_CASE("branches fall through to their true branch", "[optimizer]") {
+    SECTION("conditions are inverted and jumps are threaded") {
+        istringstream in(
+            "FUNCTION main :\n"
+            "READ t1\n"
+            "IF t1 < #0 GOTO label1\n"
+            "GOTO label2\n"
+            "LABEL label1 :\n"
+            "WRITE #1\n"
+            "GOTO label3\n"
+            "LABEL label2 :\n"
+            "GOTO label4\n"
+            "LABEL label3 :\n"
+            "LABEL label4 :\n"
+            "IF t1 == #0 GOTO label5\n"
+            "LABEL label5 :\n"
+            "RETURN #0\n"
+        );
+        auto code = ir::readIr(in);
+        CHECK(ir::simplifyBranches(code));
+        while (ir::simplifyBranches(code)) {}
+        CHECK(text(code) ==
+            "FUNCTION main :\n"
+            "READ t1\n"
+            "IF t1 >= #0 GOTO label4\n"
+            "LABEL label1 :\n"
+            "WRITE #1\n"
+            "LABEL label2 :\n"
+            "LABEL label3 :\n"
+            "LABEL label4 :\n"
+            "LABEL label5 :\n"
+            "RETURN #0\n"
+        );
+    }
+
+    SECTION("loops run fewer instructions") {
+        auto code = generate(unique_ptr<ast::Program>(parseStr(
+            "int main() {\n"
+            "    int i = 0, s = 0;\n"
+            "    while (i < 100) {\n"
+            "        if (i > 50 && s != 7) s = s + 1; else s = s - 1;\n"
+            "        i = i + 1;\n"
+            "    }\n"
+            "    write(s);\n"
+            "    return 0;\n"
+            "}\n"
+        )));
+        auto simplified = optimized(code);
+        string ir = text(simplified);
+        INFO(ir);
+        size_t gotos = 0;
+        for (auto& tac: simplified.tacs) {
+            if (tac.op == ir::Opcode::GOTO) ++gotos;
+        }
+        CHECK(gotos <= 2);
+
+        auto count = [](const ir::Code& code) {
+            ir::Interpreter interpreter(code);
+            istringstream in;
+            ostringstream out;
+            interpreter.run(in, out);
+            CHECK(out.str() == "-2\n");
+            return interpreter.executed();
+        };
+        CHECK(count(simplified) * 2 < count(code));
+    }
+}
+
+
+TEST_CASE("repeated computations are reused", "[optimizer]") {
+    auto count = [](const ir::Code& code, ir::Opcode op) {
+        size_t n = 0;
+        for (auto& tac: code.tacs) n += tac.op == op;
+        return n;
+    };
+
+    SECTION("within a block, in either order of operands") {
+        auto code = optimized(generate(unique_ptr<ast::Program>(parseStr(
+            "int main() {\n"
+            "    int a = read(), b = read();\n"
+            "    write(a * b + b * a - a * b);\n"
+            "    a = a + 1;\n"
+            "    write(a * b);\n"
+            "    return 0;\n"
+            "}\n"
+        ))));
+        INFO(text(code));
+        CHECK(count(code, ir::Opcode::MUL) == 2);
+        CHECK(run(code, "3\n4") == "12\n16\n");
+    }
+
+    SECTION("over the dominator tree") {
+        auto code = generate(unique_ptr<ast::Program>(parseStr(
+            "int main() {\n"
+            "    int a = read(), b = read(), c = 0;\n"
+            "    int d = a * b;\n"
+            "    if (d > 10) c = a * b + 1; else c = b * a - 1;\n"
+            "    write(c + a * b);\n"
+            "    return 0;\n"
+            "}\n"
+        )));
+        auto local = optimized(code), global = optimized(code, 2);
+        INFO(text(global));
+        CHECK(count(local, ir::Opcode::MUL) > 1);
+        CHECK(count(global, ir::Opcode::MUL) == 1);
+        for (auto input: { "3\n4", "1\n2" }) {
+            CHECK(run(global, input) == run(code, input));
+        }
+    }
+
+    SECTION("places that may change behind calls are read again") {
+        istringstream in(
+            "FUNCTION main :\n"
+            "READ t1\n"
+            "t2 := &t1\n"
+            "t3 := t1 + #1\n"
+            "*t2 := #5\n"
+            "t4 := t1 + #1\n"
+            "WRITE t3\n"
+            "WRITE t4\n"
+            "RETURN #0\n"
+        );
+        auto code = ir::readIr(in);
+        CHECK_FALSE(ir::numberValues(code));
+        CHECK(run(optimized(code, 2), "1") == "2\n6\n");
+    }
+}
+
+
+TEST_CASE("loop invariants are hoisted to a preheader", "[optimizer]") {
+    SECTION("out of a while loop") {
+        auto code = generate(unique_ptr<ast::Program>(parseStr(
+            "int main() {\n"
+            "    int a = read(), b = read(), i = 0, s = 0;\n"
+            "    while (i < 10) {\n"
+            "        int c = a * b + 2;\n"
+            "        s = s + c * i;\n"
+            "        i = i + 1;\n"
+            "    }\n"
+            "    write(s);\n"
+            "    return 0;\n"
+            "}\n"
+        )));
+        // multiplications ahead of the header of the loop
+        auto preheaderMultiplications = [](const ir::Code& code) {
+            ir::Cfg cfg(code, 0, code.size());
+            REQUIRE(cfg.loops().size() == 1);
+            size_t n = 0;
+            for (size_t i = 0; i < cfg[cfg.loops()[0].header].first; ++i) n += code.tacs[i].op == ir::Opcode::MUL;
+            return n;
+        };
+        simplify(code);
+        auto hoisted = code;
+        CHECK(ir::moveLoopInvariants(hoisted));
+        INFO(text(hoisted));
+        CHECK(preheaderMultiplications(code) == 0);
+        CHECK(preheaderMultiplications(hoisted) == 1);
+
+        ir::Interpreter before(code), after(hoisted);
+        istringstream in1("3\n4"), in2("3\n4");
+        ostringstream out1, out2;
+        before.run(in1, out1);
+        after.run(in2, out2);
+        CHECK(out2.str() == "630\n");
+        CHECK(out1.str() == out2.str());
+        CHECK(after.executed() < before.executed());
+        CHECK(run(optimized(code, 2), "3\n4") == "630\n");
+    }
+
+    SECTION("only where they cannot fail when the loop does not run") {
+        istringstream in(
+            "FUNCTION main :\n"
+            "READ t1\n"
+            "READ t2\n"
+            "t3 := #0\n"
+            "LABEL label1 :\n"
+            "IF t3 >= t1 GOTO label2\n"
+            "t4 := #100 / t2\n"
+            "t5 := t2 + #1\n"
+            "t3 := t3 + t4\n"
+            "t3 := t3 + t5\n"
+            "GOTO label1\n"
+            "LABEL label2 :\n"
+            "WRITE t3\n"
+            "RETURN #0\n"
+        );
+        auto code = ir::readIr(in);
+        auto hoisted = code;
+        CHECK(ir::moveLoopInvariants(hoisted));
+        INFO(text(hoisted));
+        CHECK(hoisted.size() == code.size());
+        CHECK(hoisted.tacs[4].op == ir::Opcode::ADD);
+        CHECK(hoisted.tacs[7].op == ir::Opcode::DIV);
+        for (auto input: { "0\n0", "30\n5" }) {
+            CHECK(run(hoisted, input) == run(code, input));
+        }
+    }
+
+    SECTION("nor where they would fail before output of the loop") {
+        istringstream in(
+            "FUNCTION main :\n"
+            "READ t1\n"
+            "READ t2\n"
+            "t3 := #0\n"
+            "LABEL label1 :\n"
+            "WRITE t3\n"
+            "t4 := t1 / t2\n"
+            "t5 := t1 * t2\n"
+            "t3 := t3 + #1\n"
+            "IF t3 < #4 GOTO label1\n"
+            "WRITE t4\n"
+            "WRITE t5\n"
+            "RETURN #0\n"
+        );
+        auto code = ir::readIr(in);
+        auto hoisted = code;
+        CHECK(ir::moveLoopInvariants(hoisted));
+        INFO(text(hoisted));
+        CHECK(hoisted.tacs[4].op == ir::Opcode::MUL);
+        CHECK(hoisted.tacs[7].op == ir::Opcode::DIV);
+        CHECK(run(hoisted, "30\n5") == run(code, "30\n5"));
+
+        ir::Interpreter interpreter(hoisted);
+        istringstream input("5\n0");
+        ostringstream output;
+        CHECK_THROWS_WITH(interpreter.run(input, output), "division by zero");
+        CHECK(output.str() == "0\n");
+    }
+}
+
+
+TEST_CASE("induction variables are strength reduced", "[optimizer]") {
+    auto multiplications = [](const ir::Code& code) {
+        size_t n = 0;
+        for (auto& tac: code.tacs) n += tac.op == ir::Opcode::MUL;
+        return n;
+    };
+
+    SECTION("with dead ones removed") {
+        auto code = generate(unique_ptr<ast::Program>(parseStr(
+            "int main() {\n"
+            "    int n = read(), k = n, i = 0, j = 5, s = 0;\n"
+            "    while (k > 0) {\n"
+            "        s = s + j * 4 + i * 3;\n"
+            "        j = j + 1;\n"
+            "        k = k - 1;\n"
+            "        i = i + 2;\n"
+            "    }\n"
+            "    write(s);\n"
+            "    return i;\n"
+            "}\n"
+        )));
+        auto reduced = optimized(code, 2);
+        INFO(text(reduced));
+        CHECK(multiplications(reduced) == 0);
+        for (auto input: { "0", "1", "7" }) {
+            CHECK(run(reduced, input) == run(code, input));
+        }
+
+        // `j' is read only by `j * 4', so its step goes along with the multiplication
+        auto simplified = code;
+        simplify(simplified);
+        ir::Operand j;
+        for (auto& tac: simplified.tacs) {
+            int32_t step;
+            if (tac.op == ir::Opcode::ADD && tac.arg1 == tac.result && ir::intConstant(simplified, tac.arg2, step) && step == 1) {
+                j = tac.result;
+            }
+        }
+        REQUIRE(j.isPlace());
+        CHECK(ir::reduceInductionVariables(simplified));
+        INFO(text(simplified));
+        for (auto& tac: simplified.tacs) CHECK_FALSE((tac.op == ir::Opcode::ADD && tac.result == j));
+        // what is left of it is the initial value, which the preheader folds
+        simplify(simplified);
+        for (auto& tac: simplified.tacs) {
+            for (auto operand: { tac.result, tac.arg1, tac.arg2 }) CHECK(operand != j);
+        }
+    }
+
+    SECTION("with those read by inner loops kept") {
+        auto code = generate(unique_ptr<ast::Program>(parseStr(
+            "int main() {\n"
+            "    int i = 0, b = 0, j;\n"
+            "    while (i < 3) {\n"
+            "        j = 0;\n"
+            "        while (j < 3) {\n"
+            "            write(j * 4 + b);\n"
+            "            j = j + 1;\n"
+            "        }\n"
+            "        write(b * 2);\n"
+            "        b = b + 8;\n"
+            "        i = i + 1;\n"
+            "    }\n"
+            "    return 0;\n"
+            "}\n"
+        )));
+        auto reduced = optimized(code, 2);
+        INFO(text(reduced));
+        CHECK(run(reduced, "") == "0\n4\n8\n0\n8\n12\n16\n16\n16\n20\n24\n32\n");
+        CHECK(run(reduced, "") == run(code, ""));
+    }
+
+    SECTION("for addresses of array elements") {
+        ifstream in(filesystem::path(SPLC_CORPUS_DIR) / "../sample/test04.ir");
+        auto code = ir::readIr(in);
+        auto local = optimized(code), reduced = optimized(code, 2);
+        INFO(text(reduced));
+        CHECK(multiplications(local) == 2);
+        CHECK(multiplications(reduced) == 0);
+
+        ir::Interpreter before(local), after(reduced);
+        istringstream in1, in2;
+        ostringstream out1, out2;
+        before.run(in1, out1);
+        after.run(in2, out2);
+        CHECK(out2.str() == "1\n3\n");
+        CHECK(out1.str() == out2.str());
+        CHECK(after.executed() < before.executed());
+    }
+}
+
+
+TEST_CASE("small functions are inlined", "[optimizer]") {
+    auto calls = [](const ir::Code& code) {
+        size_t n = 0;
+        for (auto& tac: code.tacs) n += tac.op == ir::Opcode::CALL;
+        return n;
+    };
+
+    SECTION("unless they are recursive or too large") {
+        auto code = generate(unique_ptr<ast::Program>(parseStr(
+            "int sq(int x) {\n"
+            "    return x * x;\n"
+            "}\n"
+            "int clamp(int v, int lo, int hi) {\n"
+            "    if (v < lo) return lo;\n"
+            "    if (v > hi) return hi;\n"
+            "    return v;\n"
+            "}\n"
+            "int fact(int n) {\n"
+            "    if (n <= 1) return 1;\n"
+            "    return n * fact(n - 1);\n"
+            "}\n"
+            "int main() {\n"
+            "    int n = read(), i = 0, s = 0;\n"
+            "    while (i < n) {\n"
+            "        s = s + clamp(sq(i), 2, 50);\n"
+            "        i = i + 1;\n"
+            "    }\n"
+            "    write(s);\n"
+            "    write(fact(n));\n"
+            "    return 0;\n"
+            "}\n"
+        )));
+        auto inlined = optimized(code, 2);
+        INFO(text(inlined));
+        CHECK(calls(inlined) == 2);
+        size_t functions = 0;
+        for (auto& tac: inlined.tacs) functions += tac.op == ir::Opcode::FUNCTION;
+        CHECK(functions == 2);
+        for (auto input: { "0", "3", "8" }) {
+            CHECK(run(inlined, input) == run(code, input));
+        }
+
+        auto kept = code;
+        ir::optimize(kept, 2, 0);
+        CHECK(calls(kept) == 4);
+    }
+
+    SECTION("with places read before assignment starting as zero") {
+        istringstream in(
+            "FUNCTION count :\n"
+            "PARAM v1\n"
+            "v2 := v2 + v1\n"
+            "RETURN v2\n"
+            "FUNCTION main :\n"
+            "ARG #3\n"
+            "t1 := CALL count\n"
+            "ARG #4\n"
+            "t2 := CALL count\n"
+            "WRITE t1\n"
+            "WRITE t2\n"
+            "RETURN #0\n"
+        );
+        auto code = ir::readIr(in);
+        CHECK(ir::inlineCalls(code, ir::DEFAULT_INLINE_LIMIT));
+        INFO(text(code));
+        CHECK(calls(code) == 0);
+        CHECK(run(code, "") == "3\n4\n");
+    }
+}
+
+
+TEST_CASE("temporaries take the numbers of those no longer live", "[optimizer]") {
+    SECTION("down to as many as are live at once") {
+        istringstream in(
+            "FUNCTION main :\n"
+            "READ t1\n"
+            "READ t2\n"
+            "t3 := t1 + t2\n"
+            "t4 := t1 - t2\n"
+            "t5 := t3 * t4\n"
+            "t6 := t5\n"
+            "t7 := t6 + #1\n"
+            "WRITE t7\n"
+            "WRITE t6\n"
+            "RETURN #0\n"
+        );
+        auto code = ir::readIr(in);
+        CHECK(ir::temporaryCount(code) == 7);
+        auto renumbered = code;
+        CHECK(ir::renumberTemporaries(renumbered));
+        INFO(text(renumbered));
+        CHECK(ir::temporaryCount(renumbered) == 3);
+        CHECK(renumbered.size() == code.size() - 1);
+        CHECK(run(renumbered, "5 3") == run(code, "5 3"));
+    }
+
+    SECTION("but not those of variables and of places whose address is taken") {
+        istringstream in(
+            "FUNCTION main :\n"
+            "DEC v1 8\n"
+            "t1 := &v1\n"
+            "READ t2\n"
+            "*t1 := t2\n"
+            "t3 := &v1\n"
+            "t4 := t3 + #4\n"
+            "*t4 := t2\n"
+            "t5 := *t3\n"
+            "t6 := *t4\n"
+            "t7 := t5 + t6\n"
+            "WRITE t7\n"
+            "RETURN #0\n"
+        );
+        auto code = ir::readIr(in);
+        auto renumbered = code;
+        CHECK(ir::renumberTemporaries(renumbered));
+        INFO(text(renumbered));
+        CHECK(ir::temporaryCount(renumbered) < ir::temporaryCount(code));
+        for (auto& tac: renumbered.tacs) {
+            for (auto operand: { tac.result, tac.arg1, tac.arg2 }) {
+                if (operand.kind() == ir::Operand::Kind::TEMP) CHECK(operand.value() != code.tacs[1].result.value());
+            }
+        }
+        CHECK(run(renumbered, "9") == "18\n");
+    }
+
+    SECTION("in every function of optimized programs") {
+        auto code = generate(unique_ptr<ast::Program>(parseStr(
+            "int poly(int a, int b, int c) {\n"
+            "    return (a + b) * (b + c) - (a - c) * (a * b + c);\n"
+            "}\n"
+            "int main() {\n"
+            "    int x = read(), y = read();\n"
+            "    write(poly(x, y, x + y) + poly(y, x, x - y) * 2);\n"
+            "    return 0;\n"
+            "}\n"
+        )));
+        for (int level: { 1, 2 }) {
+            auto renumbered = optimized(code, level);
+            INFO(text(renumbered));
+            CHECK(ir::temporaryCount(renumbered) * 3 < ir::temporaryCount(code));
+            CHECK(run(renumbered, "3 7") == run(code, "3 7"));
+        }
+    }
+}
+
+
+TEST_CASE("optimized programs behave like the generated ones", "[optimizer]") {
+    const filesystem::path corpus(SPLC_CORPUS_DIR);
+    const pair<filesystem::path, vector<string>> programs[] = {
+        { corpus / "../sample/test01.spl", { "5", "0", "-3" } },
+        { corpus / "../sample/test02.spl", { "1", "2", "7" } },
+        { corpus / "test_4_r01.spl", { "" } },
+        { corpus / "test_4_r02.spl", { "0", "1", "5", "12" } },
+        { corpus / "test_4_r03.spl", { "" } },
+    };
+    for (auto& program: programs) {
+        auto code = compileFile(program.first.string());
+        auto folded = optimized(code), numbered = optimized(code, 2);
+        CHECK(folded.size() <= code.size());
+        CHECK(numbered.size() <= code.size());
+        for (auto& input: program.second) {
+            INFO(program.first << " with input " << input);
+            string output = run(code, input);
+            CHECK(run(folded, input) == output);
+            CHECK(run(numbered, input) == output);
+        }
+    }
+}
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ast_dump.hpp"
+#include "catch.hpp"
+#include "parser.hpp"
+
+using namespace std;
+
+
+// dump of the AST, or an empty string if the source cannot be parsed
+static string parseAndDump(const string& path) {
+    FILE *file = fopen(path.c_str(), "r");
+    if (file == nullptr) return "cannot open " + path;
+    unique_ptr<ast::Program> program(parseFile(file));
+    fclose(file);
+    if (program == nullptr) return "";
+    ostringstream dump;
+    auto printer = make_unique<ast::Printer>(dump);
+    program->traverse({ printer.get() });
+    return dump.str();
+}
+
+
+TEST_CASE("sources can be parsed concurrently", "[parser]") {
+    vector<string> paths;
+    for (auto& entry: filesystem::directory_iterator(SPLC_CORPUS_DIR)) {
+        if (entry.path().extension() == ".spl") paths.push_back(entry.path().string());
+    }
+    sort(paths.begin(), paths.end());
+    REQUIRE_FALSE(paths.empty());
+
+    vector<string> expected;
+    for (auto& path: paths) expected.push_back(parseAndDump(path));
+
+    const size_t threadNum = max(4u, thread::hardware_concurrency());
+    const size_t rounds = 4;
+    // every thread parses the whole corpus, starting from a different file
+    vector<vector<string>> results(threadNum, vector<string>(paths.size()));
+    vector<thread> threads;
+    for (size_t t = 0; t < threadNum; ++t) {
+        threads.emplace_back([&, t]() {
+            for (size_t round = 0; round < rounds; ++round) {
+                for (size_t i = 0; i < paths.size(); ++i) {
+                    size_t file = (i + t) % paths.size();
+                    results[t][file] = parseAndDump(paths[file]);
+                }
+            }
+        });
+    }
+    for (auto& worker: threads) worker.join();
+
+    for (size_t t = 0; t < threadNum; ++t) {
+        for (size_t i = 0; i < paths.size(); ++i) {
+            INFO("thread " << t << " parsing " << paths[i]);
+            CHECK(results[t][i] == expected[i]);
+        }
+    }
+}
+
+
+TEST_CASE("regular files and pipes are parsed alike", "[parser]") {
+    // padded to a multiple of the usual page size, so that the sentinels land past the mapped file
+    string src = "int main() {\n    int a = 1;\n    return a + 2;\n}\n//";
+    src.append(4096 - src.size() - 1, '-');
+    src += '\n';
+    REQUIRE(src.size() == 4096);
+
+    string path = (filesystem::temp_directory_path() / "splc_test_parser.spl").string();
+    FILE *file = fopen(path.c_str(), "w");
+    REQUIRE(file != nullptr);
+    fputs(src.c_str(), file);
+    fclose(file);
+
+    string expected = parseAndDump(path);
+    CHECK_FALSE(expected.empty());
+
+    SECTION("a pipe is read through stdio") {
+        FILE *pipe = popen(("cat " + path).c_str(), "r");
+        REQUIRE(pipe != nullptr);
+        unique_ptr<ast::Program> program(parseFile(pipe));
+        pclose(pipe);
+        REQUIRE(program != nullptr);
+        ostringstream dump;
+        auto printer = make_unique<ast::Printer>(dump);
+        program->traverse({ printer.get() });
+        CHECK(dump.str() == expected);
+    }
+
+    SECTION("an empty file is an empty program") {
+        fclose(fopen(path.c_str(), "w"));
+        file = fopen(path.c_str(), "r");
+        unique_ptr<ast::Program> program(parseFile(file));
+        fclose(file);
+        REQUIRE(program != nullptr);
+        CHECK(program->extDefs.empty());
+    }
+
+    filesystem::remove(path);
+}
@@ -0,0 +1,154 @@
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include "catch.hpp"
+#include "gen_tac.hpp"
+#include "interpreter.hpp"
+#include "ir_reader.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+#include "semantic.hpp"
+#include "ssa.hpp"
+
+using namespace std;
+
+
+static ir::Code read(const char *text) {
+    istringstream in(text);
+    return ir::readIr(in);
+}
+
+static string run(const ir::Code& code, const string& input) {
+    ir::Interpreter interpreter(code);
+    interpreter.setStepLimit(10000000);
+    istringstream in(input);
+    ostringstream out;
+    interpreter.run(in, out);
+    return out.str();
+}
+
+// names assigned more than once, by phis or instructions
+static size_t reassigned(const ir::SsaForm& ssa) {
+    set<uint32_t> names;
+    size_t count = 0;
+    auto assign = [&](ir::Operand name) {
+        if (!names.insert(name.value()).second) ++count;
+    };
+    for (auto& function: ssa.functions) {
+        for (auto& block: function.blocks) {
+            for (auto& phi: block.phis) assign(phi.result);
+            for (auto& tac: block.tacs) {
+                if (ir::writesResult(tac.op) && tac.result.isPlace()) assign(tac.result);
+            }
+        }
+    }
+    return count;
+}
+
+
+TEST_CASE("places are assigned once in SSA form", "[ssa]") {
+    auto code = read(
+        "FUNCTION main :\n"
+        "t1 := #1\n"
+        "t2 := #2\n"
+        "t3 := #0\n"
+        "LABEL label1 :\n"
+        "IF t3 >= #3 GOTO label2\n"
+        "t4 := t1\n"
+        "t1 := t2\n"
+        "t2 := t4\n"
+        "t3 := t3 + #1\n"
+        "GOTO label1\n"
+        "LABEL label2 :\n"
+        "WRITE t1\n"
+        "WRITE t2\n"
+        "RETURN #0\n"
+        "WRITE t4\n"
+    );
+    ir::SsaForm ssa(code);
+    REQUIRE(ssa.functions.size() == 1);
+    auto& blocks = ssa.functions[0].blocks;
+    REQUIRE(blocks.size() == 4);    // without the unreachable one
+    CHECK(reassigned(ssa) == 0);
+
+    SECTION("phis merge the places assigned in the loop") {
+        auto& header = blocks[1];
+        CHECK(header.preds == vector<uint32_t> { 0, 2 });
+        REQUIRE(header.phis.size() == 3);
+        set<uint32_t> origins;
+        for (auto& phi: header.phis) {
+            origins.insert(ssa.originOf(phi.result).value());
+            REQUIRE(phi.args.size() == 2);
+            CHECK(ssa.originOf(phi.args[0]) == ssa.originOf(phi.result));
+            CHECK(phi.args[0] != phi.args[1]);
+        }
+        CHECK(origins == set<uint32_t> { 1, 2, 3 });
+        CHECK(blocks[3].phis.empty());
+    }
+
+    SECTION("phis reading each other are lowered in parallel") {
+        // propagates copies over the SSA form, which turns the loop into a swap of two phis
+        unordered_map<uint32_t, ir::Operand> sources;
+        for (auto& block: blocks) {
+            for (auto& tac: block.tacs) {
+                if (tac.op == ir::Opcode::ASSIGN && tac.arg1.isPlace()) sources[tac.result.value()] = tac.arg1;
+            }
+        }
+        auto resolve = [&](ir::Operand& operand) {
+            while (operand.isPlace() && sources.count(operand.value())) operand = sources[operand.value()];
+        };
+        for (auto& block: blocks) {
+            for (auto& phi: block.phis) {
+                for (auto& arg: phi.args) resolve(arg);
+            }
+            for (auto& tac: block.tacs) ir::forEachUse(tac, [&](ir::Operand& operand, bool) { resolve(operand); });
+        }
+
+        ssa.lower();
+        CHECK(run(code, "") == "2\n1\n");
+    }
+
+    SECTION("lowering keeps the behavior") {
+        ssa.lower();
+        CHECK(run(code, "") == "2\n1\n");
+    }
+}
+
+
+TEST_CASE("programs behave the same through SSA form", "[ssa]") {
+    const filesystem::path corpus(SPLC_CORPUS_DIR);
+    const pair<filesystem::path, vector<string>> programs[] = {
+        { corpus / "../sample/test01.spl", { "5", "0", "-3" } },
+        { corpus / "../sample/test02.spl", { "1", "2", "7" } },
+        { corpus / "test_4_r01.spl", { "" } },
+        { corpus / "test_4_r02.spl", { "0", "1", "5", "12" } },
+        { corpus / "test_4_r03.spl", { "" } },
+    };
+    for (auto& program: programs) {
+        INFO(program.first);
+        FILE *file = fopen(program.first.c_str(), "r");
+        REQUIRE(file != nullptr);
+        unique_ptr<ast::Program> ast(parseFile(file));
+        fclose(file);
+        REQUIRE(ast != nullptr);
+        REQUIRE(smt::analyzeSemantic(ast.get()).empty());
+        auto code = ir::TacGenerator(ast.get()).getTac();
+
+        auto lowered = code;
+        ir::SsaForm ssa(lowered);
+        CHECK(reassigned(ssa) == 0);
+        ssa.lower();
+        auto optimized = lowered;
+        ir::optimize(optimized, 1);
+        for (auto& input: program.second) {
+            INFO("input " << input);
+            string output = run(code, input);
+            CHECK(run(lowered, input) == output);
+            CHECK(run(optimized, input) == output);
+        }
+    }
+}
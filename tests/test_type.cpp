@@ -1,4 +1,6 @@
 #include <memory>
+#include <string>
+#include <vector>
 #include "catch.hpp"
 #include "symbol_table.hpp"
 #include "type.hpp"
@@ -8,18 +10,20 @@ using namespace smt;
 
 
 TEST_CASE("types are comparable", "[ast-type]") {
-    auto charType = makeType<PrimitiveType>(Primitive::CHAR);
-    auto intType = makeType<PrimitiveType>(Primitive::INT);
+    TypeContext types;
+    const Type *charType = TypeContext::primitive(Primitive::CHAR);
+    const Type *intType = TypeContext::primitive(Primitive::INT);
 
     SECTION("comparing primitive types") {
         CHECK(*charType != *intType);
+        CHECK(charType == TypeContext::primitive(Primitive::CHAR));
     }
 
     SECTION("comparing 1D arrays") {
-        auto charArrT1 = makeType<ArrayType>(charType, 5);
-        auto charArrT2 = makeType<ArrayType>(charType, 5);
-        auto intArrT1 = makeType<ArrayType>(intType, 5);
-        auto intArrT2 = makeType<ArrayType>(intType, 6);
+        auto charArrT1 = types.array(charType, 5);
+        auto charArrT2 = types.array(charType, 5);
+        auto intArrT1 = types.array(intType, 5);
+        auto intArrT2 = types.array(intType, 6);
         CHECK(as<ArrayType>(charArrT1) == as<ArrayType>(charArrT2));
         CHECK(*charArrT1 == *charArrT2);
         CHECK(*charArrT1 != *intArrT1);
@@ -27,24 +31,44 @@ TEST_CASE("types are comparable", "[ast-type]") {
     }
 
     SECTION("constructing 2D arrays") {
-        auto char1dArrT1 = makeType<ArrayType>(charType, 5);
-        auto char1dArrT2 = makeType<ArrayType>(charType, 5);
-        auto char2dArrT1 = makeType<ArrayType>(char1dArrT1, 3);
+        auto char1dArrT1 = types.array(charType, 5);
+        auto char1dArrT2 = types.array(charType, 5);
+        auto char2dArrT1 = types.array(char1dArrT1, 3);
 
         REQUIRE(as<ArrayType>(char2dArrT1).size == 3);
         REQUIRE(*as<ArrayType>(char2dArrT1).baseType == *char1dArrT2);
 
         SECTION("comparing 2D arrays") {
-            auto char2dArrT2 = makeType<ArrayType>(char1dArrT2, 3);
-            auto char2dArrT3 = makeType<ArrayType>(char1dArrT1, 4);
+            auto char2dArrT2 = types.array(char1dArrT2, 3);
+            auto char2dArrT3 = types.array(char1dArrT1, 4);
             CHECK(*char2dArrT1 == *char2dArrT2);
             CHECK(*char2dArrT2 != *char2dArrT3);
         }
     }
 
+    SECTION("equal types are interned") {
+        CHECK(types.array(charType, 5) == types.array(charType, 5));
+        CHECK(types.array(charType, 5) != types.array(charType, 6));
+        CHECK(types.function(intType, { charType }) == types.function(intType, { charType }));
+        CHECK(types.function(intType, { charType }) != types.function(intType, { intType }));
+        CHECK(types.function(intType) != types.function(charType));
+
+        TypeContext another;
+        CHECK(another.array(charType, 5) != types.array(charType, 5));
+        CHECK(*another.array(charType, 5) == *types.array(charType, 5));
+    }
+
+    SECTION("structures are not merged") {
+        StructType *s1 = types.structure(), *s2 = types.structure();
+        CHECK(s1 != s2);
+        CHECK(*s1 == *s2);
+        CHECK(types.array(s1, 2) != types.array(s2, 2));
+        CHECK(*types.array(s1, 2) == *types.array(s2, 2));
+    }
+
     SECTION("comparing structure types") {
-        auto charField = make_pair(charType, string("field1"));
-        auto intField = make_pair(intType, string("field2"));
+        auto charField = make_pair(charType, Ident("field1"));
+        auto intField = make_pair(intType, Ident("field2"));
         auto s1 = make_unique<StructType>(std::initializer_list { charField, intField });
 
         CHECK(*s1->getFieldType("field1") == *charType);
@@ -68,8 +92,8 @@ TEST_CASE("types are comparable", "[ast-type]") {
             FunctionType procType1(nullptr, { charType, intType });
             FunctionType procType2(nullptr, { intType, charType });
             FunctionType procType3(nullptr, {
-                makeType<PrimitiveType>(Primitive::CHAR),
-                makeType<PrimitiveType>(Primitive::INT)
+                TypeContext::primitive(Primitive::CHAR),
+                TypeContext::primitive(Primitive::INT)
             });
             CHECK(procType1 != procType2);
             CHECK(procType1 == procType3);
@@ -85,10 +109,10 @@ TEST_CASE("types are comparable", "[ast-type]") {
     }
 
     SECTION("comparing type alias") {
-        auto charA1 = makeType<TypeAlias>("Alias1", charType);
-        auto charA2 = makeType<TypeAlias>("Alias2", makeType<PrimitiveType>(Primitive::CHAR));
-        auto charA3 = makeType<TypeAlias>("Alias3", charA1);
-        auto intAlias = makeType<TypeAlias>("IntAlias", intType);
+        auto charA1 = types.alias("Alias1", charType);
+        auto charA2 = types.alias("Alias2", TypeContext::primitive(Primitive::CHAR));
+        auto charA3 = types.alias("Alias3", charA1);
+        auto intAlias = types.alias("IntAlias", intType);
 
         CHECK(*charA1 == *charA2);
         CHECK(*charType == *charA2);
@@ -100,43 +124,45 @@ TEST_CASE("types are comparable", "[ast-type]") {
 
 SCENARIO("types on the symbol table can be referenced", "[ast-scope]") {
 
-    GIVEN("some symbol tables and types") {
-        auto intType = makeType<PrimitiveType>(Primitive::INT);
-        auto charType = makeType<PrimitiveType>(Primitive::CHAR);
+    GIVEN("a symbol table with nested scopes and some types") {
+        TypeContext types;
+        const Type *intType = TypeContext::primitive(Primitive::INT);
 
-        auto globalScope = make_shared<SymbolTable>(nullptr);
-        auto funcScope = make_shared<SymbolTable>(globalScope);
-        auto blockScope = make_shared<SymbolTable>(funcScope);
+        SymbolTable symbols;
+        symbols.pushScope();    // function scope
 
         WHEN("there is no data") {
+            symbols.pushScope();
+
             THEN("nothing can be found") {
-                CHECK_FALSE(blockScope->getType("abc"));
-                CHECK_FALSE(blockScope->getType("def"));
+                CHECK(symbols.lookup("abc") == nullptr);
+                CHECK(symbols.lookup("def") == nullptr);
             }
         }
 
         WHEN("a symbol is set to null (which represents an incomplete status)") {
-            funcScope->setType("a", nullptr);
+            symbols.declare("a", nullptr);
+            symbols.pushScope();
 
             THEN("it can be accessed in the block scope") {
-                auto opt = blockScope->getType("a");
-                CHECK(opt);
-                CHECK_FALSE(opt.value());
+                const Symbol *symbol = symbols.lookup("a");
+                REQUIRE(symbol != nullptr);
+                CHECK(symbol->type == nullptr);
             }
+        }
 
-            WHEN("a reserved symbol is referenced") {
-                auto refer = blockScope->getType("a").value();
-                blockScope->setType("b", refer);
+        WHEN("a structure is referenced before it is completed") {
+            StructType *structType = types.structure();
+            symbols.declare("a", structType);
+            symbols.pushScope();
+            symbols.declare("b", symbols.lookup("a")->type);
 
-                THEN("updated value can be retrived at any time") {
-                    auto type = funcScope->getType("a").value();
-                    type.set(new PrimitiveType(Primitive::INT));
+            THEN("its fields can be retrived at any time") {
+                structType->fields.emplace_back(intType, "field");
 
-                    auto hdl = blockScope->getType("b");
-                    CHECK(hdl);
-                    auto b = hdl.value();
-                    CHECK(as<PrimitiveType>(b).primitive == Primitive::INT);
-                }
+                const Symbol *b = symbols.lookup("b");
+                REQUIRE(b != nullptr);
+                CHECK(as<StructType>(b->type).getFieldType("field") == intType);
             }
         }
     }
@@ -145,49 +171,92 @@ SCENARIO("types on the symbol table can be referenced", "[ast-scope]") {
 
 SCENARIO("symbol table works", "[ast-scope]") {
 
-    GIVEN("some symbol tables and types") {
-        auto intType = makeType<PrimitiveType>(Primitive::INT);
-        auto charType = makeType<PrimitiveType>(Primitive::CHAR);
+    GIVEN("a symbol table with nested scopes and some types") {
+        const Type *intType = TypeContext::primitive(Primitive::INT);
+        const Type *charType = TypeContext::primitive(Primitive::CHAR);
 
-        auto globalScope = make_shared<SymbolTable>(nullptr);
-        auto funcScope = make_shared<SymbolTable>(globalScope);
-        auto blockScope = make_shared<SymbolTable>(funcScope);
+        SymbolTable symbols;
+        Symbol& id1 = symbols.declare("id1", intType);
+        REQUIRE(*symbols.lookup("id1")->type == *intType);
+        REQUIRE(symbols.lookup("id2") == nullptr);
+        CHECK(symbols.size() == 1);
+        CHECK(symbols.depth() == 0);
+        CHECK_FALSE(symbols.canOverwrite("id1"));
 
-        globalScope->setType("id1", intType);
-        REQUIRE(*globalScope->getType("id1").value() == *intType);
-        REQUIRE_FALSE(globalScope->getType("id2"));
-        CHECK(globalScope->size() == 1);
-        CHECK(blockScope->isLowerThan(blockScope));
-        CHECK(blockScope->isLowerThan(funcScope));
-        CHECK(blockScope->isLowerThan(globalScope));
-        CHECK_FALSE(funcScope->isLowerThan(blockScope));
+        symbols.pushScope();    // function scope
+        CHECK(symbols.depth() == 1);
+        CHECK(symbols.canOverwrite("id1"));
 
         WHEN("adding a new symbol") {
-            funcScope->setType("id2", charType);
+            symbols.declare("id2", charType);
 
             THEN("the new symbol can be found in the current scope") {
-                REQUIRE(*funcScope->getType("id2").value() == *charType);
-            }
-
-            THEN("the new symbol cannot be found in the upper scope") {
-                CHECK_FALSE(globalScope->getType("id2"));
+                REQUIRE(*symbols.lookup("id2")->type == *charType);
+                CHECK_FALSE(symbols.canOverwrite("id2"));
             }
 
             THEN("the new symbol can be found in the sub scope") {
-                CHECK(*blockScope->getType("id2").value() == *charType);
+                symbols.pushScope();
+                CHECK(*symbols.lookup("id2")->type == *charType);
+                CHECK(symbols.canOverwrite("id2"));
             }
 
             THEN("size of current scope is increased by 1") {
-                REQUIRE(funcScope->size() == 2);
+                REQUIRE(symbols.size() == 2);
             }
 
-            THEN("size of parent scope doesn't change") {
-                REQUIRE(globalScope->size() == 1);
+            THEN("the new symbol is gone with its scope") {
+                symbols.popScope();
+                CHECK(symbols.lookup("id2") == nullptr);
+                REQUIRE(symbols.size() == 1);
+            }
+        }
+
+        WHEN("a symbol is shadowed in an inner scope") {
+            Symbol& inner = symbols.declare("id1", charType);
+
+            THEN("the inner one is found") {
+                CHECK(symbols.lookup("id1") == &inner);
+                CHECK(symbols.size() == 2);
             }
 
-            THEN("size of sub scope is increased by 1") {
-                REQUIRE(blockScope->size() == 2);
+            THEN("the outer one is visible again after the inner scope is closed") {
+                symbols.popScope();
+                CHECK(symbols.lookup("id1") == &id1);
+                CHECK(*id1.type == *intType);
+            }
+        }
+
+        WHEN("a symbol is redeclared in the same scope") {
+            Symbol& first = symbols.declare("id3", intType);
+            Symbol& second = symbols.declare("id3", charType);
+
+            THEN("the same symbol gets the new type") {
+                CHECK(&first == &second);
+                CHECK(*symbols.lookup("id3")->type == *charType);
+                CHECK(symbols.size() == 2);
+            }
+        }
+
+        WHEN("many symbols are declared") {
+            std::vector<Symbol*> declared;
+            for (int i = 0; i < 1000; ++i) {
+                declared.push_back(&symbols.declare("v" + std::to_string(i), intType));
+            }
+
+            THEN("all of them can be found at their original places") {
+                for (int i = 0; i < 1000; ++i) {
+                    REQUIRE(symbols.lookup("v" + std::to_string(i)) == declared[i]);
+                }
+                CHECK(symbols.lookup("id1") == &id1);
+            }
+
+            THEN("all of them are gone with their scope") {
+                symbols.popScope();
+                CHECK(symbols.lookup("v0") == nullptr);
+                CHECK(symbols.lookup("v999") == nullptr);
+                CHECK(symbols.size() == 1);
             }
         }
     }
-}
\ No newline at end of file
+}
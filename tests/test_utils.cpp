@@ -1,6 +1,13 @@
+#include <cstdint>
 #include <vector>
 #include <list>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "arena.hpp"
 #include "catch.hpp"
+#include "ident.hpp"
+#include "stats.hpp"
 #include "utils.hpp"
 
 using namespace std;
@@ -128,3 +135,69 @@ SCENARIO("share data using Shared", "[Shared]") {
 }
 
 // TODO: test overloaded operators
+
+
+TEST_CASE("Arena hands out aligned memory from its chunks", "[Arena]") {
+    Arena arena(256);
+    CHECK(arena.bytesUsed() == 0);
+
+    SECTION("allocations are aligned and owned by the arena") {
+        void *p1 = arena.allocate(3);
+        void *p2 = arena.allocate(sizeof(double), alignof(double));
+        CHECK(reinterpret_cast<std::uintptr_t>(p1) % alignof(std::max_align_t) == 0);
+        CHECK(reinterpret_cast<std::uintptr_t>(p2) % alignof(double) == 0);
+        CHECK(p1 != p2);
+        CHECK(arena.owns(p1));
+        CHECK(arena.owns(p2));
+
+        int onStack = 0;
+        CHECK_FALSE(arena.owns(&onStack));
+    }
+
+    SECTION("requests larger than a chunk are served as well") {
+        auto big = static_cast<char*>(arena.allocate(1024));
+        big[1023] = 'x';
+        CHECK(arena.owns(big + 1023));
+        CHECK(arena.bytesUsed() >= 1024);
+    }
+}
+
+
+TEST_CASE("identifiers are interned", "[Ident]") {
+    Ident a1("alpha"), a2(std::string("alpha")), b("beta");
+
+    CHECK(a1 == a2);
+    CHECK(a1.value() == a2.value());
+    CHECK(a1 != b);
+    CHECK(std::hash<Ident>()(a1) == std::hash<Ident>()(a2));
+
+    SECTION("the text can be recovered") {
+        CHECK(a1.str() == "alpha");
+        CHECK(b.str() == "beta");
+        CHECK(a1 == "alpha");
+        CHECK(a1 != "beta");
+    }
+
+    SECTION("substrings are interned by content") {
+        const char *src = "alphabet";
+        CHECK(Ident(std::string_view(src, 5)) == a1);
+        CHECK(Ident(std::string_view(src, 8)) != a1);
+    }
+}
+
+
+TEST_CASE("statistics are reported as JSON", "[Stats]") {
+    Stats stats("dir\\\"name\".spl");
+    int result = stats.time("phase", []() { return 42; });
+    stats.count("counter", 7);
+
+    CHECK(result == 42);
+    CHECK_THROWS(stats.time("failed", []() { throw std::runtime_error("failed"); }));
+
+    std::ostringstream json;
+    stats.printJson(json);
+    std::string str = json.str();
+    CHECK(str.find("{\"source\":\"dir\\\\\\\"name\\\".spl\",\"phases\":{\"phase\":") == 0);
+    CHECK(str.find(",\"failed\":") != std::string::npos);
+    CHECK(str.find("\"counters\":{\"counter\":7}}\n") != std::string::npos);
+}
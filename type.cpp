@@ -9,6 +9,7 @@ bool PrimitiveType::operator==(const PrimitiveType& other) const {
 }
 
 bool PrimitiveType::operator==(const Type& other) const {
+    if (this == &other) return true;
     if (typeid(TypeAlias) == typeid(other)) return other == *this;
     return typeid(PrimitiveType) == typeid(other) &&
         *this == dynamic_cast<const PrimitiveType&>(other);
@@ -19,10 +20,11 @@ bool PrimitiveType::operator==(Primitive p) const {
 }
 
 bool ArrayType::operator==(const ArrayType& other) const {
-    return size == other.size && *baseType == *other.baseType;
+    return size == other.size && (baseType == other.baseType || *baseType == *other.baseType);
 }
 
 bool ArrayType::operator==(const Type& other) const {
+    if (this == &other) return true;
     if (typeid(TypeAlias) == typeid(other)) return other == *this;
     return typeid(ArrayType) == typeid(other) &&
         *this == dynamic_cast<const ArrayType&>(other);
@@ -38,17 +40,18 @@ bool StructType::operator==(const StructType& other) const {
 }
 
 bool StructType::operator==(const Type& other) const {
+    if (this == &other) return true;
     if (typeid(TypeAlias) == typeid(other)) return other == *this;
     return typeid(StructType) == typeid(other) &&
         *this == dynamic_cast<const StructType&>(other);
 }
 
-Shared<Type> StructType::getFieldType(const std::string& name) const {
+const Type * StructType::getFieldType(Ident name) const {
     for (auto& field: fields) {
         if (field.second == name)
             return field.first;
     }
-    return Shared<Type>(nullptr);
+    return nullptr;
 }
 
 bool FunctionType::operator==(const FunctionType& other) const {
@@ -63,6 +66,7 @@ bool FunctionType::operator==(const FunctionType& other) const {
 }
 
 bool FunctionType::operator==(const Type& other) const {
+    if (this == &other) return true;
     if (typeid(TypeAlias) == typeid(other)) return other == *this;
     return typeid(FunctionType) == typeid(other) &&
         *this == dynamic_cast<const FunctionType&>(other);
@@ -75,3 +79,42 @@ bool TypeAlias::operator==(const TypeAlias& other) const {
 bool TypeAlias::operator==(const Type& other) const {
     return *base == other;
 }
+
+
+const PrimitiveType * TypeContext::primitive(Primitive p) {
+    static const PrimitiveType primitives[] = {
+        PrimitiveType(Primitive::CHAR),
+        PrimitiveType(Primitive::INT),
+        PrimitiveType(Primitive::FLOAT),
+        PrimitiveType(Primitive::AUTO)
+    };
+    return &primitives[int(p)];
+}
+
+const ArrayType * TypeContext::array(const Type * baseType, size_t size) {
+    auto& type = arrays[ArrayKey(baseType, size)];
+    if (type == nullptr) type = std::make_unique<ArrayType>(baseType, size);
+    return type.get();
+}
+
+const FunctionType * TypeContext::function(const Type * returned, const std::vector<const Type *>& parameters) {
+    FunctionKey key;
+    key.reserve(parameters.size() + 1);
+    key.push_back(returned);
+    key.insert(key.end(), parameters.begin(), parameters.end());
+    auto& type = functions[key];
+    if (type == nullptr) type = std::make_unique<FunctionType>(returned, parameters);
+    return type.get();
+}
+
+StructType * TypeContext::structure() {
+    auto type = new StructType;
+    others.emplace_back(type);
+    return type;
+}
+
+const TypeAlias * TypeContext::alias(std::string name, const Type * base) {
+    auto type = new TypeAlias(std::move(name), base);
+    others.emplace_back(type);
+    return type;
+}
@@ -1,13 +1,15 @@
 #ifndef TYPE_H
 #define TYPE_H
 
+#include <functional>
 #include <memory>
 #include <utility>
 #include <vector>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
-#include "utils.hpp"
+#include "ident.hpp"
 
 namespace smt {
 
@@ -36,16 +38,16 @@ struct PrimitiveType final: public Type {
 };
 
 struct ArrayType final: public Type {
-    Shared<Type> baseType;
+    const Type * baseType;
     size_t size;
 
-    ArrayType(Shared<Type> baseType, size_t size):
-        baseType(std::move(baseType)), size(size) {}
+    ArrayType(const Type * baseType, size_t size):
+        baseType(baseType), size(size) {}
     bool operator==(const ArrayType& other) const;
     bool operator==(const Type& other) const override;
 };
 
-using StructField = std::pair<Shared<Type>, std::string>;
+using StructField = std::pair<const Type *, Ident>;
 
 struct StructType final: public Type {
     std::vector<StructField> fields;
@@ -53,25 +55,25 @@ struct StructType final: public Type {
     explicit StructType(std::vector<StructField> fields = {}): fields(std::move(fields)) {}
     bool operator==(const StructType& other) const;
     bool operator==(const Type& other) const override;
-    Shared<Type> getFieldType(const std::string& name) const;
+    const Type * getFieldType(Ident name) const;
 };
 
 struct FunctionType final: public Type {
-    Shared<Type> returned;
-    std::vector<Shared<Type>> parameters;
+    const Type * returned;
+    std::vector<const Type *> parameters;
 
-    explicit FunctionType(Shared<Type> returned, std::vector<Shared<Type>> parameters = {}):
-        returned(std::move(returned)), parameters(std::move(parameters)) {}
+    explicit FunctionType(const Type * returned, std::vector<const Type *> parameters = {}):
+        returned(returned), parameters(std::move(parameters)) {}
     bool operator==(const FunctionType& other) const;
     bool operator==(const Type& other) const override;
 };
 
 struct TypeAlias: public Type {
     std::string name;
-    Shared<Type> base;
+    const Type * base;
 
-    TypeAlias(std::string name, Shared<Type> base):
-        name(std::move(name)), base(std::move(base)) {}
+    TypeAlias(std::string name, const Type * base):
+        name(std::move(name)), base(base) {}
 
     bool operator==(const TypeAlias&) const;
     bool operator==(const Type&) const override;
@@ -82,15 +84,49 @@ inline static bool operator==(const Type& a, const TypeAlias& b) {
 }
 
 
-template<typename T, typename... Args, typename std::enable_if<std::is_base_of<Type, T>::value>::type* = nullptr>
-inline Shared<Type> makeType(Args... args) {
-    return Shared<Type>(new T(args...));
-}
+/**
+ * Owns the types of a program and hash-conses them, so that structurally equal
+ * primitive, array and function types are represented by the same object.
+ * Structures are nominal: each definition gets its own object, completed in place.
+ */
+class TypeContext {
+private:
+    using ArrayKey = std::pair<const Type *, size_t>;
+    using FunctionKey = std::vector<const Type *>;  // return type followed by parameter types
+
+    struct KeyHash {
+        size_t operator()(const ArrayKey& key) const {
+            return std::hash<const Type *>()(key.first) * 31 + key.second;
+        }
+        size_t operator()(const FunctionKey& key) const {
+            size_t h = key.size();
+            for (auto type: key) h = h * 31 + std::hash<const Type *>()(type);
+            return h;
+        }
+    };
+
+    std::unordered_map<ArrayKey, std::unique_ptr<ArrayType>, KeyHash> arrays;
+    std::unordered_map<FunctionKey, std::unique_ptr<FunctionType>, KeyHash> functions;
+    std::vector<std::unique_ptr<Type>> others;
+
+public:
+    TypeContext() = default;
+    TypeContext(const TypeContext&) = delete;
+    TypeContext& operator=(const TypeContext&) = delete;
+
+    // primitive types are immutable singletons shared by all contexts
+    static const PrimitiveType * primitive(Primitive p);
+
+    const ArrayType * array(const Type * baseType, size_t size);
+    const FunctionType * function(const Type * returned, const std::vector<const Type *>& parameters = {});
+    StructType * structure();
+    const TypeAlias * alias(std::string name, const Type * base);
+};
 
 
 template<typename T, typename std::enable_if<std::is_base_of<Type, T>::value>::type* = nullptr>
-inline T& as(Shared<Type> type) {
-    return dynamic_cast<T&>(*type);
+inline const T& as(const Type * type) {
+    return dynamic_cast<const T&>(*type);
 }
 
 
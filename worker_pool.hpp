@@ -0,0 +1,48 @@
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Runs task(0), ..., task(count - 1) on up to `workers` threads, including the calling one.
+ * Workers take the next index as soon as they are free, so uneven tasks are balanced.
+ * The first exception thrown by a task is rethrown once all workers have stopped.
+ */
+template <typename Task>
+void parallelFor(size_t count, unsigned workers, Task&& task) {
+    std::atomic<size_t> next { 0 };
+    std::exception_ptr failure;
+    std::mutex failureMutex;
+
+    auto work = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            try {
+                task(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(failureMutex);
+                if (failure == nullptr) failure = std::current_exception();
+                next = count;   // give up the remaining tasks
+            }
+        }
+    };
+
+    size_t threadNum = std::min<size_t>(std::max(workers, 1u), count);
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadNum; ++i) threads.emplace_back(work);
+    work();
+    for (auto& thread: threads) thread.join();
+
+    if (failure != nullptr) std::rethrow_exception(failure);
+}
+
+inline unsigned defaultWorkerNum() {
+    unsigned hardware = std::thread::hardware_concurrency();
+    return hardware > 0 ? hardware : 1;
+}
+
+#endif // WORKER_POOL_HPP